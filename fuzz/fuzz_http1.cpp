@@ -0,0 +1,35 @@
+#include "../include/file_utils.h"
+#include "../include/http1.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+// One HTTP/1.x request head: parsing, keep-alive, body framing and the
+// cache key
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    std::string head(reinterpret_cast<const char *>(data), size);
+    HttpRequest request = http1::parse_request(head);
+    http1::keep_alive(head);
+    http1::find_header(head, "upgrade");
+    size_t body = 0;
+    if (http1::body_length(head, body)) {
+        // Framing sees the same lines as header lookup
+        std::string length = http1::find_header(head, "content-length");
+        if (strtoull(length.c_str(), nullptr, 10) != body) {
+            abort();
+        }
+    }
+
+    // A routed key stays beneath the root
+    std::string key;
+    if (!file_utils::request_key(request.path, key)) {
+        return 0;
+    }
+    if (key.empty() || key[0] != '/' || key[key.size() - 1] == '/' ||
+        key.find("/../") != std::string::npos ||
+        key.find('\0') != std::string::npos) {
+        abort();
+    }
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include "../include/file_utils.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+// Path normalization: accepted paths come out canonical
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    std::string path(reinterpret_cast<const char *>(data), size);
+    if (!file_utils::normalize_path(path)) {
+        return 0;
+    }
+    if (path.empty() || path[0] != '/' ||
+        path.find('\0') != std::string::npos ||
+        path.find("//") != std::string::npos) {
+        abort();
+    }
+
+    // No segment is "." or ".."
+    size_t begin = 1;
+    while (begin <= path.size()) {
+        size_t end = std::min(path.find('/', begin), path.size());
+        std::string segment = path.substr(begin, end - begin);
+        if (segment == "." || segment == "..") {
+            abort();
+        }
+        begin = end + 1;
+    }
+    return 0;
+}
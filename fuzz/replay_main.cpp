@@ -0,0 +1,57 @@
+#include <cstddef>
+#include <cstdint>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+
+// Runs a fuzz target over corpus files for compilers without libFuzzer,
+// e.g. to replay crashes or check seeds under GCC's sanitizers. Arguments
+// are files or directories of files.
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+namespace {
+size_t replay_file(const std::string &path) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::stringstream bytes;
+    bytes << in.rdbuf();
+    std::string input = bytes.str();
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t *>(input.data()),
+                           input.size());
+    return 1;
+}
+
+size_t replay(const std::string &path) {
+    struct stat info;
+    if (stat(path.c_str(), &info) < 0) {
+        std::cerr << "Warning: cannot read " << path << std::endl;
+        return 0;
+    }
+    if (!S_ISDIR(info.st_mode)) {
+        return replay_file(path);
+    }
+    size_t count = 0;
+    DIR *dir = opendir(path.c_str());
+    while (struct dirent *entry = dir ? readdir(dir) : nullptr) {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..") {
+            count += replay(path + "/" + name);
+        }
+    }
+    if (dir != nullptr) {
+        closedir(dir);
+    }
+    return count;
+}
+} // namespace
+
+int main(int argc, char *argv[]) {
+    size_t count = 0;
+    for (int i = 1; i < argc; ++i) {
+        count += replay(argv[i]);
+    }
+    std::cout << "Replayed " << count << " inputs" << std::endl;
+    return 0;
+}
@@ -0,0 +1,43 @@
+#ifndef ADMIN_H
+#define ADMIN_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Runtime control state shared by every worker, and the plumbing of the
+// Unix-domain admin socket. Commands are lines of words; each reply is
+// text lines ending in "OK" or "ERROR <reason>".
+namespace admin {
+// Per-worker counters, one cache line each so workers never share one
+struct alignas(64) Counters {
+    std::atomic<uint64_t> accepted;
+    std::atomic<uint64_t> closed;
+    std::atomic<uint64_t> requests;
+};
+
+const size_t MAX_COUNTERS = 256; // Workers beyond this share slots
+
+// Mapped shared and anonymous before any fork, so worker processes and
+// the master read and write the same block
+struct Control {
+    std::atomic<uint64_t> purge_generation; // Bumped by every purge
+    std::atomic<uint32_t> log_sample; // Log 1 of N connections; 0 is off
+    Counters counters[MAX_COUNTERS];
+};
+
+// A zeroed control block; throws std::runtime_error if mapping fails
+Control *map_control();
+void unmap_control(Control *control);
+
+// Listening Unix socket at path, replacing a stale one and readable only
+// by the owner. Throws std::runtime_error on failure.
+int open_socket(const std::string &path);
+
+// Splits a command line on spaces and tabs
+std::vector<std::string> split(const std::string &line);
+} // namespace admin
+
+#endif // ADMIN_H
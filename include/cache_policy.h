@@ -0,0 +1,36 @@
+#ifndef CACHE_POLICY_H
+#define CACHE_POLICY_H
+
+#include "config.h"
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Compiled form of a host's cache rules. Exact and prefix patterns share
+// a byte trie walked once along the path, and extensions are a single hash
+// lookup, so matching is O(path length) regardless of the rule count.
+class CachePolicy {
+  public:
+    // Throws std::runtime_error for patterns other than "/exact",
+    // "/prefix/*" and "*.ext"
+    explicit CachePolicy(const std::vector<CacheRule> &rules);
+
+    // Returns the winning rule for a canonical path, or nullptr
+    const CacheRule *match(const std::string &path) const;
+
+  private:
+    struct Node {
+        std::vector<std::pair<char, int>> children;
+        int exact;  // Rule index or -1
+        int prefix; // Rule index or -1
+    };
+
+    std::vector<CacheRule> rules;
+    std::vector<Node> nodes;
+    std::unordered_map<std::string, int> extensions;
+
+    int insert_path(const std::string &path);
+};
+
+#endif // CACHE_POLICY_H
@@ -1,11 +1,96 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <cstddef>
+#include <map>
 #include <string>
+#include <vector>
+
+// One listening socket. address is an IPv4 or IPv6 literal, or
+// "unix:/path" for a Unix domain socket (port and TCP options unused).
+struct ListenerConfig {
+    std::string address = "0.0.0.0";
+    int port = 8080;
+    bool v6_only = false;  // IPv6 only: refuse v4-mapped clients
+    int backlog = 128;     // listen() queue length
+    int defer_accept = 0;  // TCP_DEFER_ACCEPT seconds; 0 disables
+    int fastopen = 0;      // TCP_FASTOPEN queue length; 0 disables
+    bool nodelay = true;   // TCP_NODELAY on accepted sockets
+    int send_buffer = 0;   // SO_SNDBUF bytes; 0 keeps the kernel default
+    // "hash" or "cpu": one SO_REUSEPORT socket per worker, picked by the
+    // kernel's flow hash or by the CPU that received the connection
+    std::string reuseport = "off";
+};
+
+// Per-client limits; a rate of 0 disables that check
+struct RateLimitConfig {
+    double requests_per_second = 0; // Sustained requests per address
+    double request_burst = 50;       // Requests allowed back to back
+    double bytes_per_second = 0;     // Sustained response bytes per address
+    double byte_burst = 8 * 1024 * 1024;
+    unsigned max_connections = 0; // Concurrent connections per address
+    double prefix_multiplier = 8; // /24 and /64 budgets, in addresses
+    size_t table_size = 65536;    // Buckets across all shards
+};
+
+// Placement of cached bodies. With neither option set they stay on the
+// heap; otherwise they are carved from pooled mappings.
+struct MemoryConfig {
+    bool huge_pages = false;  // 2MB pages: MAP_HUGETLB, else MADV_HUGEPAGE
+    std::string numa = "off"; // "off", "replicate" or "interleave"
+};
+
+// Hot-set snapshot for warm restarts; an empty file disables it
+struct HotSetConfig {
+    std::string file;            // Snapshot path, rewritten every interval
+    unsigned interval = 60;      // Seconds between snapshots
+    size_t max_entries = 1024;   // Busiest paths kept per snapshot
+    unsigned warmup_threads = 4; // Parallel loaders at startup
+};
+
+// Response caching headers for paths matching pattern, which is an exact
+// path ("/favicon.ico"), a prefix ("/assets/*") or an extension ("*.css").
+// Exact beats the longest prefix, which beats an extension.
+struct CacheRule {
+    std::string pattern;
+    std::string cache_control; // Cache-Control value; empty omits it
+    long expires = -1;         // Expires in seconds from now; -1 omits it
+};
+
+// A site selected by the Host header
+struct VirtualHostConfig {
+    std::vector<std::string> server_names; // Host values, without port
+    std::string root_directory;
+    size_t cache_size = 64 * 1024 * 1024;
+    bool precompressed = false; // Serve "file.gz" to clients accepting gzip
+    std::map<int, std::string> error_pages; // Status -> path under root
+    std::vector<CacheRule> cache_rules;
+};
 
 struct ServerConfig {
     int port = 8080;                         // Default port
+    unsigned workers = 1;                    // Event loop threads
+    unsigned processes = 0; // Forked worker processes; 0 runs in-process
+    size_t shared_cache_size = 256 * 1024 * 1024; // Segment for processes
+    size_t io_budget = 256 * 1024; // Bytes per connection per wakeup
+    std::string admin_socket; // Unix socket for admin commands; empty: off
+    unsigned log_sample = 1;  // Log 1 of every N connections; 0: none
+    std::vector<ListenerConfig> listeners;   // Empty: IPv4 on port
     std::string root_directory = "./public"; // Default directory to serve
+    size_t cache_size = 64 * 1024 * 1024;    // Bytes of responses cached
+    size_t max_cached_file_size = 1024 * 1024; // Larger files are not cached
+    RateLimitConfig rate_limit;
+    HotSetConfig hot_set;
+    MemoryConfig memory;
+    // Written on SIGUSR1 when built with ENABLE_TRACING; worker process N
+    // appends ".N"
+    std::string trace_file = "static_server_trace.json";
+
+    // Settings of the default host, used when no virtual host matches
+    bool precompressed = false;
+    std::map<int, std::string> error_pages;
+    std::vector<CacheRule> cache_rules;
+    std::vector<VirtualHostConfig> virtual_hosts;
 };
 
-#endif // CONFIG_H
\ No newline at end of file
+#endif // CONFIG_H
@@ -0,0 +1,13 @@
+#ifndef CONFIG_FILE_H
+#define CONFIG_FILE_H
+
+#include "config.h"
+#include <string>
+
+// Loads a JSON configuration file. Keys mirror ServerConfig; see
+// README.md for the full layout. Throws std::runtime_error on syntax
+// errors, unknown keys and values of the wrong type.
+ServerConfig load_config_file(const std::string &path);
+ServerConfig parse_config(const std::string &text);
+
+#endif // CONFIG_FILE_H
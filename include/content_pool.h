@@ -0,0 +1,40 @@
+#ifndef CONTENT_POOL_H
+#define CONTENT_POOL_H
+
+#include "file_cache.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Carves cached bodies out of large anonymous mappings, optionally backed
+// by 2MB huge pages and placed on NUMA nodes. Bodies are rounded up to a
+// size class; a released slot goes on its class's free list for the next
+// body of that size, and a chunk is unmapped once no body cut from it is
+// alive, so churn reuses memory instead of pinning chunks.
+class ContentPool {
+  public:
+    static const int ANY_NODE = -1;   // Leave placement to the kernel
+    static const int INTERLEAVE = -2; // Spread pages over all nodes
+
+    // nodes lists the memory nodes, used for INTERLEAVE. Once a new chunk
+    // would take the mappings past max_bytes (0: no limit), bodies that do
+    // not fit a free slot are kept on the heap instead.
+    ContentPool(bool huge_pages, int node, const std::vector<int> &nodes,
+                size_t max_bytes = 0);
+
+    // Copies bytes into the pool; falls back to the heap if mapping fails
+    Content store(const char *data, size_t size);
+
+    // Bytes currently mapped, free slots and unused chunk tails included
+    size_t mapped_bytes() const;
+
+  private:
+    // Shared with every slice, which hands its slot back when released;
+    // outlives the pool while slices do
+    struct State;
+    struct Release;
+
+    std::shared_ptr<State> state;
+};
+
+#endif // CONTENT_POOL_H
@@ -0,0 +1,49 @@
+#ifndef CONTENT_STORE_H
+#define CONTENT_STORE_H
+
+#include "content_pool.h"
+#include "file_cache.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// XXH64 of the bytes (seed 0). Used as the deduplication key and ETag.
+uint64_t content_hash(const char *data, size_t size);
+
+// Strong entity tag for a body hash: the quoted 16-digit hex value
+std::string content_etag(uint64_t hash);
+
+// Cached bodies keyed by content hash, so byte-identical files served
+// under different paths or hosts share one buffer. Only weak references
+// are kept: a body is freed when the last cache entry using it goes.
+class ContentStore {
+  public:
+    // Bodies are copied into pool, or kept on the heap when it is null
+    explicit ContentStore(ContentPool *pool);
+
+    // The shared body equal to bytes, stored first if it is new
+    Content intern(uint64_t hash, std::string bytes);
+
+    // Where bodies are copied, for buffers that should sit next to them
+    ContentPool *placement() const;
+
+    size_t entry_count() const;
+    uint64_t deduplicated() const; // intern() calls that found a copy
+
+  private:
+    struct Body {
+        std::weak_ptr<const char> data;
+        size_t size;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_multimap<uint64_t, Body> bodies;
+    ContentPool *pool;
+    size_t sweep_at; // Drop expired bodies when the table reaches this
+    uint64_t reused;
+};
+
+#endif // CONTENT_STORE_H
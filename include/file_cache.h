@@ -0,0 +1,123 @@
+#ifndef FILE_CACHE_H
+#define FILE_CACHE_H
+
+#include "hpack.h"
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Immutable body bytes. Small bodies own a string; pooled bodies are a
+// slice of a ContentPool chunk that stays mapped while any slice is alive.
+class Content {
+  public:
+    Content() : length(0) {}
+    Content(const char *bytes) : owned(bytes), length(owned.size()) {}
+    Content(std::string bytes)
+        : owned(std::move(bytes)), length(owned.size()) {}
+    Content(std::shared_ptr<const char> slice, size_t length)
+        : pooled(std::move(slice)), length(length) {}
+
+    const char *data() const { return pooled ? pooled.get() : owned.data(); }
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    // The shared bytes, or null for owned ones
+    const std::shared_ptr<const char> &slice() const { return pooled; }
+
+  private:
+    std::string owned;
+    std::shared_ptr<const char> pooled;
+    size_t length;
+};
+
+class ContentPool;
+
+// Bodies up to this size are also kept right after their HTTP/1.1 header
+const size_t PACKET_BODY_LIMIT = 4096;
+
+// A fully prepared response: the body plus its HTTP/1.1 header and HPACK
+// header block, both formatted once when the entry is built.
+struct CachedFile {
+    int status;
+    std::string content_type;
+    Content body;
+    std::string http1_header; // Status line and headers, ends in CRLFCRLF
+    std::string hpack_header; // Static-table-only HPACK header block
+    // http1_header followed by the body, sent as one buffer; empty for
+    // empty bodies and ones over PACKET_BODY_LIMIT
+    Content packet;
+
+    // Identity of the file the body was read from, for revalidation
+    dev_t device;
+    ino_t inode;
+    off_t size;
+    struct timespec mtime;
+    time_t stale_at;   // Rebuild after this (time-dependent headers); 0 never
+    bool gzip_variant; // A precompressed "<path>.gz" sibling exists
+    uint64_t content_hash; // Body hash behind the ETag; 0 when there is none
+
+    bool matches(const struct stat &st) const;
+};
+
+const char *status_reason(int status);
+
+// Builds an entry and pre-encodes its headers for both protocols. Extra
+// header names are given in HTTP/1.1 case and lowercased for HTTP/2.
+// A small response's packet is copied into pool, or the heap when null.
+std::shared_ptr<CachedFile>
+build_cached_file(int status, const std::string &content_type,
+                  Content body,
+                  const hpack::HeaderList &extra_headers = hpack::HeaderList(),
+                  ContentPool *pool = nullptr);
+
+// Fills file.packet from its header and body when the body is small
+void prepare_packet(CachedFile &file, ContentPool *pool = nullptr);
+
+// Bytes an entry holds: the body plus its prepared headers and packet
+size_t cached_size(const CachedFile &file);
+
+// Size-bounded LRU of prepared responses keyed by canonical request path
+class FileCache {
+  public:
+    explicit FileCache(size_t max_bytes);
+
+    std::shared_ptr<const CachedFile> find(const std::string &key);
+    void insert(const std::string &key,
+                const std::shared_ptr<const CachedFile> &file);
+    bool erase(const std::string &key); // False if key was not cached
+    // Removes every key starting with prefix; returns how many
+    size_t erase_prefix(const std::string &prefix);
+    void clear();
+
+    // Up to limit cached keys, busiest first, then most recently used.
+    // With decay, hit counts are halved so the order follows recent
+    // traffic.
+    std::vector<std::pair<std::string, uint64_t>> hot_set(size_t limit,
+                                                          bool decay = true);
+
+    size_t size_bytes() const;
+    size_t entry_count() const;
+
+  private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const CachedFile> file;
+        uint64_t hits; // Lookups served, for hot_set()
+    };
+
+    mutable std::mutex mutex;
+    std::list<Entry> lru; // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t max_bytes;
+    size_t current_bytes;
+
+    void evict_to(size_t limit);
+};
+
+#endif // FILE_CACHE_H
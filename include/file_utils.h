@@ -1,12 +1,33 @@
 #ifndef FILE_UTILS_H
 #define FILE_UTILS_H
 
+#include <cstddef>
 #include <string>
 
 namespace file_utils {
 bool file_exists(const std::string &path);
 std::string read_file(const std::string &path);
 std::string get_file_extension(const std::string &path);
+
+// Percent-decodes a request path and removes "." / ".." segments and
+// duplicate slashes in place. Returns false for malformed escapes, NUL
+// bytes, or paths that would climb above the root.
+bool normalize_path(std::string &path);
+
+// The cache key a request target resolves to: normalized, with
+// "index.html" added to directories. False if normalization fails.
+bool request_key(const std::string &target, std::string &key);
+
+// Opens a path relative to dir_fd read-only, refusing to resolve outside
+// dir_fd (openat2 RESOLVE_BENEATH where available). Returns -1 on failure.
+int open_beneath(int dir_fd, const char *relative_path);
+
+// Reads the whole regular file behind fd. Throws on read errors.
+std::string read_fd(int fd, size_t size_hint = 0);
+
+// Pulls the first size bytes of fd into the page cache (readahead, or a
+// MAP_POPULATE mapping as fallback). Returns false if neither worked.
+bool prefetch_fd(int fd, size_t size);
 } // namespace file_utils
 
-#endif // FILE_UTILS_H
\ No newline at end of file
+#endif // FILE_UTILS_H
@@ -0,0 +1,26 @@
+#ifndef HOT_SET_H
+#define HOT_SET_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Snapshot of the most requested paths, persisted so a restarted server
+// can warm its caches before taking traffic.
+namespace hot_set {
+struct Entry {
+    std::string host; // First server name of the virtual host, "*" default
+    std::string key;  // File cache key
+    uint64_t hits;
+};
+
+// Writes the snapshot atomically (temporary file, then rename). Returns
+// false on I/O errors.
+bool save(const std::string &path, const std::vector<Entry> &entries);
+
+// Reads a snapshot written by save(). A missing file gives an empty set
+// and malformed lines are skipped.
+std::vector<Entry> load(const std::string &path);
+} // namespace hot_set
+
+#endif // HOT_SET_H
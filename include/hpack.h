@@ -0,0 +1,55 @@
+#ifndef HPACK_H
+#define HPACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace hpack {
+typedef std::pair<std::string, std::string> Header;
+typedef std::vector<Header> HeaderList;
+
+// Decoded size of one header block, counted as in SETTINGS_MAX_HEADER_
+// LIST_SIZE: name plus value plus 32 bytes per field
+const size_t DEFAULT_MAX_HEADER_LIST_SIZE = 64 * 1024;
+
+// Stateful HPACK decoder (RFC 7541) with a bounded dynamic table. One
+// instance per connection, fed complete header blocks in arrival order.
+class Decoder {
+  public:
+    explicit Decoder(size_t max_table_size = 4096,
+                     size_t max_list_size = DEFAULT_MAX_HEADER_LIST_SIZE);
+
+    // Decodes one complete header block. Returns false on a compression
+    // error or when the decoded list outgrows max_list_size, after which
+    // the connection must be torn down.
+    bool decode(const uint8_t *data, size_t len, HeaderList &headers);
+
+  private:
+    std::deque<Header> dynamic_table; // Newest entry first
+    size_t table_size;
+    size_t max_table_size;     // Current limit, set by size updates
+    size_t settings_table_size; // Upper bound we advertised
+    size_t max_list_size;
+
+    bool lookup(uint64_t index, Header &header) const;
+    void insert(const Header &header);
+    void evict(size_t limit);
+};
+
+// Encoders are stateless: they only reference the static table and emit
+// literals without indexing, so a block can be encoded once and replayed
+// on any connection.
+void encode_integer(std::string &out, uint64_t value, int prefix_bits,
+                    uint8_t first_byte);
+void encode_string(std::string &out, const std::string &value);
+void encode_header(std::string &out, const std::string &name,
+                   const std::string &value);
+
+bool huffman_decode(const uint8_t *data, size_t len, std::string &out);
+} // namespace hpack
+
+#endif // HPACK_H
@@ -0,0 +1,33 @@
+#ifndef HTTP1_H
+#define HTTP1_H
+
+#include "request.h"
+#include <string>
+
+// Parsing of HTTP/1.x request heads. A head is the request line and
+// headers through the blank line that ends them.
+namespace http1 {
+// Value of the first header called name (lowercase) with surrounding
+// blanks removed; empty if there is none
+std::string find_header(const std::string &head, const char *name);
+
+// Method and target of the request line, with any query string dropped.
+// Words are split on whitespace up to the first CR.
+void parse_request_line(const std::string &head, std::string &method,
+                        std::string &path);
+
+// The fields used for routing
+HttpRequest parse_request(const std::string &head);
+
+// True for HTTP/1.1 requests without "Connection: close"
+bool keep_alive(const std::string &head);
+
+// Length of the body that follows head, 0 without Content-Length. False
+// when the body cannot be framed safely: any Transfer-Encoding, or a
+// Content-Length that is malformed, padded before the colon or repeated
+// with a different value. Lines are split as find_header splits them,
+// and a bare LF anywhere is refused, so no header hides behind one.
+bool body_length(const std::string &head, size_t &length);
+} // namespace http1
+
+#endif // HTTP1_H
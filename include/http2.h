@@ -0,0 +1,87 @@
+#ifndef HTTP2_H
+#define HTTP2_H
+
+#include "file_cache.h"
+#include "hpack.h"
+#include "request.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+
+namespace http2 {
+extern const char CONNECTION_PREFACE[];
+const size_t CONNECTION_PREFACE_LENGTH = 24;
+
+// Resolves one request to a prepared response
+typedef std::function<std::shared_ptr<const CachedFile>(
+    const HttpRequest &request)>
+    RequestHandler;
+
+// Server side of one HTTP/2 connection (RFC 7540). The session does no I/O:
+// received bytes go in through receive() and frames to send come out of
+// produce(), so it can be driven by any event loop.
+class Session {
+  public:
+    explicit Session(const RequestHandler &handler);
+
+    // h2c upgrade: applies the HTTP2-Settings header and answers the
+    // upgraded HTTP/1.1 request as stream 1. The client preface follows.
+    bool upgrade(const std::string &settings_header,
+                 const HttpRequest &request);
+
+    // Consumes received bytes, starting with the client connection preface.
+    // Returns false once the connection is unusable; a GOAWAY may still be
+    // waiting in produce(). A peer that keeps frames coming without reading
+    // the acks they earn is cut off with ENHANCE_YOUR_CALM.
+    bool receive(const char *data, size_t len);
+
+    // Appends roughly max_bytes of frames to out: control frames first,
+    // then HEADERS/DATA from active streams, one frame per stream per round
+    // and within the peer's flow-control windows.
+    void produce(std::string &out, size_t max_bytes);
+
+    bool has_output() const;
+    bool is_closed() const;
+
+  private:
+    struct Stream {
+        std::shared_ptr<const CachedFile> response;
+        size_t offset;
+        int64_t send_window;
+        bool headers_sent;
+    };
+
+    RequestHandler handler;
+    hpack::Decoder decoder;
+    std::map<uint32_t, Stream> streams;
+    std::string input;
+    std::string control; // Pending SETTINGS/PING acks, WINDOW_UPDATEs etc.
+    std::string header_block;
+
+    bool preface_received;
+    bool goaway_sent;
+    bool goaway_received;
+    uint32_t last_stream_id;
+    uint32_t continuation_stream; // Stream owed a CONTINUATION, or 0
+    bool continuation_end_stream;
+    int64_t connection_window;
+    int64_t peer_initial_window;
+    uint32_t peer_max_frame_size;
+
+    bool handle_frame(uint8_t type, uint8_t flags, uint32_t stream_id,
+                      const uint8_t *payload, uint32_t length);
+    bool handle_headers(uint8_t flags, uint32_t stream_id,
+                        const uint8_t *payload, uint32_t length);
+    bool complete_headers(uint32_t stream_id);
+    bool apply_settings(const uint8_t *payload, size_t length);
+    void open_stream(uint32_t stream_id, const HttpRequest &request);
+    bool produce_stream(std::string &out, Stream &stream, uint32_t id,
+                        bool &finished);
+    bool connection_error(uint32_t error_code);
+    void reset_stream(uint32_t stream_id, uint32_t error_code);
+};
+} // namespace http2
+
+#endif // HTTP2_H
@@ -0,0 +1,99 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include "config.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sys/socket.h>
+#include <vector>
+
+// Client address in IPv6 form; IPv4 is stored v4-mapped (::ffff:a.b.c.d)
+struct ClientAddress {
+    uint8_t bytes[16];
+    bool is_ipv4;
+    bool is_local; // Unix socket peer, which is never limited
+};
+
+ClientAddress client_address_from(const struct sockaddr *addr);
+
+// Per-client token buckets for requests and bytes, tracked both for the
+// address itself and for its /24 (IPv4) or /64 (IPv6) prefix.
+//
+// Buckets live in a fixed-size open-addressing table split into shards,
+// each with its own lock, so workers never contend on a global lock.
+// Tokens are refilled lazily on access. A new entry takes the first
+// idle slot in its probe window, or else evicts the least recently used
+// entry without open connections, so a client still in debt keeps its
+// entry for as long as it keeps coming back. Only a window full of open
+// connections makes the check fail open.
+class RateLimiter {
+  public:
+    // The buckets that counted an admitted connection; one that failed
+    // open was not counted and must not be released
+    struct Admission {
+        bool address;
+        bool prefix;
+    };
+
+    explicit RateLimiter(const RateLimitConfig &config);
+
+    bool enabled() const;
+
+    // Accept-time check against the per-address and per-prefix connection
+    // caps. An admitted connection is counted until release_connection().
+    bool admit_connection(const ClientAddress &address, Admission &admission);
+    void release_connection(const ClientAddress &address,
+                            const Admission &admission);
+
+    // Takes one request token from the address and its prefix
+    bool allow_request(const ClientAddress &address);
+
+    // Charges response bytes; returns false while the client is in debt
+    bool charge_bytes(const ClientAddress &address, size_t bytes);
+
+  private:
+    struct Key {
+        uint64_t high;
+        uint64_t low;
+        uint8_t prefix; // 128 for a full address
+
+        bool operator==(const Key &other) const {
+            return high == other.high && low == other.low &&
+                   prefix == other.prefix;
+        }
+    };
+
+    struct Bucket {
+        Key key;
+        bool used;
+        uint32_t connections;
+        double request_tokens;
+        double byte_tokens;
+        int64_t last_refill; // Nanoseconds, steady clock
+    };
+
+    // Allocated separately so shard locks do not share cache lines
+    struct Shard {
+        std::mutex mutex;
+        std::vector<Bucket> buckets;
+    };
+
+    enum Operation { CONNECT, DISCONNECT, REQUEST, BYTES };
+
+    RateLimitConfig config;
+    std::vector<std::unique_ptr<Shard>> shards;
+    size_t shard_mask;
+    size_t slot_mask;
+
+    // counted is set when a CONNECT was recorded in the bucket
+    bool apply(const ClientAddress &address, uint8_t prefix, Operation op,
+               size_t amount, bool *counted = nullptr);
+    Bucket *find_or_insert(Shard &shard, const Key &key, size_t home,
+                           int64_t now, bool insert);
+    bool is_idle(const Bucket &bucket, int64_t now) const;
+    void refill(Bucket &bucket, int64_t now, double multiplier) const;
+};
+
+#endif // RATE_LIMITER_H
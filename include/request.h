@@ -0,0 +1,15 @@
+#ifndef REQUEST_H
+#define REQUEST_H
+
+#include <string>
+
+// The parts of a request used for routing, filled in by either protocol
+struct HttpRequest {
+    std::string method;
+    std::string path;            // Request target without the query
+    std::string host;            // Host header or :authority
+    std::string accept_encoding; // Accept-Encoding header
+    std::string if_none_match;   // If-None-Match header
+};
+
+#endif // REQUEST_H
@@ -1,31 +1,206 @@
 #ifndef STATIC_FILE_SERVER_H
 #define STATIC_FILE_SERVER_H
 
+#include "admin.h"
+#include "cache_policy.h"
 #include "config.h"
+#include "content_pool.h"
+#include "content_store.h"
+#include "file_cache.h"
+#include "hot_set.h"
+#include "http2.h"
+#include "rate_limiter.h"
+#include "request.h"
+#include "shared_cache.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <netinet/in.h>
 #include <string>
 #include <sys/socket.h>
+#include <sys/types.h>
+#include <ctime>
+#include <deque>
 #include <unordered_map>
+#include <vector>
 
 class StaticFileServer {
   public:
     StaticFileServer(const ServerConfig &config);
     ~StaticFileServer();
 
+    // Runs the event loops on the calling thread until stop()
     void start();
+    // Makes start() return; safe to call from any thread. In prefork mode
+    // each process has its own stop event, so it only stops the worker
+    // loops of the process it is called in; the master and its workers
+    // are stopped with SIGTERM or SIGINT.
+    void stop();
+    // Port of the first TCP listener, as bound (resolves port 0)
+    int local_port() const;
 
-  private:
-    int server_fd;
+  protected:
+    struct Worker;
+
+    // Outgoing bytes: either owned here or a view into a prepared
+    // response, which the segment keeps alive
+    struct Segment {
+        std::string owned;
+        std::shared_ptr<const CachedFile> response;
+        const char *view;
+        size_t length;
+
+        const char *data() const { return response ? view : owned.data(); }
+        size_t size() const { return response ? length : owned.size(); }
+    };
+
+    // Per-client state kept between readiness events
+    struct Connection {
+        Worker *worker; // Event loop that owns the connection
+        int fd;
+        uint32_t events;   // Interest currently registered with epoll
+        std::string input; // Received bytes not yet consumed
+        std::deque<Segment> output; // Waiting for the socket, in order
+        size_t output_offset;       // Bytes of output.front() already sent
+        std::unique_ptr<http2::Session> h2;
+        bool close_after_write;
+        size_t body_remaining; // Request body bytes still to be skipped
+        ClientAddress address;
+        RateLimiter::Admission admission;
+        bool paced; // Bandwidth limited with SO_MAX_PACING_RATE
+    };
+
+    struct Listener {
+        int fd;
+        ListenerConfig config;
+        // The one worker (numbered across processes) accepting here with
+        // reuseport; -1 when every worker shares the socket
+        int worker;
+    };
+
+    // One event loop thread with its own epoll set and connections
+    struct Worker {
+        unsigned id;
+        int node;       // NUMA node the thread is bound to, -1 if unbound
+        int cpu;        // CPU the thread is pinned to, -1 if unpinned
+        size_t replica; // Cache replica used by this worker's requests
+        int epoll_fd;
+        std::unordered_map<int, std::unique_ptr<Connection>> connections;
+        std::vector<const Listener *> listeners; // Watched by this worker
+        admin::Counters *counters; // Slot in the shared control block
+        uint64_t accepted;         // Local count, for log sampling
+    };
+
+    // A site with its own root, cache and response policies
+    struct VirtualHost {
+        VirtualHostConfig config;
+        int root_fd; // Directory fd all file opens are confined beneath
+        std::vector<std::unique_ptr<FileCache>> caches; // One per replica
+        std::unique_ptr<CachePolicy> policy;
+        std::map<int, std::shared_ptr<const CachedFile>> error_pages;
+        // Hits on files too large for the cache, for the hot set
+        std::mutex hits_mutex;
+        std::unordered_map<std::string, uint64_t> uncached_hits;
+
+        VirtualHost() : root_fd(-1) {}
+        ~VirtualHost();
+    };
+
+    std::vector<Listener> listeners;
     ServerConfig config;
     std::unordered_map<std::string, std::string> mime_types;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<int> numa_nodes; // Nodes workers are spread over; empty: off
+    // Cached bodies are replicated per node with numa "replicate"; the pools
+    // (one per replica) are empty when bodies stay on the heap
+    size_t replicas;
+    std::vector<std::unique_ptr<ContentPool>> pools;
+    // Body deduplication tables, one per replica, across all hosts
+    std::vector<std::unique_ptr<ContentStore>> stores;
+    // One segment for all worker processes when processes > 0
+    std::unique_ptr<SharedCache> shared_cache;
+    std::vector<std::unique_ptr<VirtualHost>> hosts; // hosts[0] is default
+    std::unordered_map<std::string, VirtualHost *> hosts_by_name;
+    RateLimiter rate_limiter;
+    time_t next_snapshot; // When save_hot_set() is due
+    int stop_fd; // eventfd this process's workers watch; readable on stop()
+    std::atomic<bool> stopping;
+    unsigned process_index; // Which forked worker process this is
+    admin::Control *control; // Shared with forked processes
+    int admin_fd;            // Admin socket listener, -1 if off
+    std::mutex admin_mutex;  // One admin command at a time
+    std::atomic<uint64_t> purge_generation; // Last purge applied here
+
+    // Prepared error responses, shared by every connection
+    std::shared_ptr<const CachedFile> bad_request;
+    std::shared_ptr<const CachedFile> not_found;
+    std::shared_ptr<const CachedFile> method_not_allowed;
+    std::shared_ptr<const CachedFile> server_error;
+    std::shared_ptr<const CachedFile> too_many_requests;
 
     void initialize_socket();
-    void handle_connection(int client_socket);
-    void parse_request(const std::string &request, std::string &path,
-                       std::string &method);
-    void send_response(int client_socket, const std::string &path);
+    void close_listeners();
+    int open_listener(const ListenerConfig &listener);
+    const Listener *find_listener(const Worker &worker, int fd) const;
+    void run_master();
+    pid_t spawn_process(unsigned index);
+    void run_workers();
+    void serve();
+    void run_admin();
+    void handle_admin_client(int fd);
+    std::string admin_command(const std::string &line);
+    std::vector<VirtualHost *> admin_hosts(const std::string &name);
+    std::string admin_stats();
+    std::string admin_top(size_t limit);
+    std::string admin_purge(const std::vector<VirtualHost *> &targets,
+                            const std::string &pattern);
+    std::string admin_warm(const std::vector<VirtualHost *> &targets,
+                           const std::vector<std::string> &paths);
+    void apply_purges();
+    void run_worker(Worker &worker);
+    void accept_connection(Worker &worker, const Listener &listener);
+    void add_connection(Worker &worker, int client_socket,
+                        const struct sockaddr_storage &client_addr);
+    bool handle_connection(Connection &conn);
+    bool handle_http1(Connection &conn);
+    bool flush_connection(Connection &conn);
+    void close_connection(Worker &worker, int client_socket);
+    std::shared_ptr<const CachedFile> serve_request(Connection &conn,
+                                                    const HttpRequest &request);
+    std::shared_ptr<const CachedFile>
+    resolve_request(VirtualHost &host, const HttpRequest &request,
+                    size_t replica);
+    std::shared_ptr<const CachedFile> load_file(VirtualHost &host,
+                                                const std::string &path,
+                                                bool gzip, size_t replica);
+    VirtualHost &select_host(const std::string &host_header);
+    std::shared_ptr<const CachedFile> error_response(const VirtualHost &host,
+                                                     int status) const;
+    // A 200 carrying body, with its ETag and caching headers; a small
+    // response's packet goes in pool
+    std::shared_ptr<CachedFile>
+    file_response(const VirtualHost &host, const std::string &path, bool gzip,
+                  Content body, uint64_t hash, time_t now, ContentPool *pool);
+    hpack::HeaderList caching_headers(const VirtualHost &host,
+                                      const std::string &path, time_t now,
+                                      time_t &stale_at) const;
+    std::shared_ptr<const CachedFile>
+    not_modified(const VirtualHost &host, const std::string &path,
+                 const CachedFile &file) const;
+    void send_response(Connection &conn,
+                       const std::shared_ptr<const CachedFile> &response,
+                       bool close = false);
+    http2::RequestHandler http2_handler(Connection &conn);
     std::string get_content_type(const std::string &path);
     void initialize_mime_types();
+    void initialize_memory();
+    void initialize_hosts();
+    std::unique_ptr<VirtualHost> open_host(const VirtualHostConfig &host);
+    std::string host_label(const VirtualHost &host) const;
+    std::vector<hot_set::Entry> collect_hot_set(size_t limit, bool decay);
+    void save_hot_set();
+    void warm_up();
 };
 
-#endif // STATIC_FILE_SERVER_H
\ No newline at end of file
+#endif // STATIC_FILE_SERVER_H
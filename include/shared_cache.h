@@ -0,0 +1,61 @@
+#ifndef SHARED_CACHE_H
+#define SHARED_CACHE_H
+
+#include "file_cache.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Prepared responses in one memfd segment that is mapped before worker
+// processes fork, so every process reads the same copy. The index is an
+// open-addressing table of (hash, offset) slots updated with compare-and-
+// swap; records are immutable and carved with an atomic bump offset.
+// Identical bodies are stored once, found by content hash.
+// Replaced records are not reclaimed: once the segment is full, inserts
+// fail and callers keep the response process-local. Callers refresh
+// time-dependent headers around a record's body rather than inserting
+// again, so only changed or purged files consume more space.
+class SharedCache {
+  public:
+    // Throws std::runtime_error if the segment cannot be created
+    SharedCache(size_t bytes, bool huge_pages);
+
+    // A response backed by the segment, or null
+    std::shared_ptr<const CachedFile> find(const std::string &key) const;
+
+    // Copies file into the segment and returns the shared copy, or null
+    // when the segment or the probe window is full
+    std::shared_ptr<const CachedFile> insert(const std::string &key,
+                                             const CachedFile &file);
+
+    // Unpublishes key, or every key starting with it when prefix is set;
+    // the records stay in the segment. Returns how many were removed.
+    size_t erase(const std::string &key, bool prefix);
+
+    size_t used_bytes() const;
+    size_t capacity() const;
+
+  private:
+    struct Header;
+    struct Slot {
+        std::atomic<uint64_t> hash;   // 0 while the slot is free
+        std::atomic<uint64_t> offset; // Record offset; 0 until published
+    };
+    struct Record;
+
+    std::shared_ptr<char> mapping; // Unmapped when the last body is gone
+    size_t size;
+    Header *header;
+    Slot *slots;
+
+    const Record *record_at(uint64_t offset) const;
+    bool key_matches(uint64_t offset, const std::string &key) const;
+    // Record offset for key, or 0; verify compares the record's own key
+    uint64_t lookup(const std::string &key, bool verify) const;
+    bool publish(const std::string &key, uint64_t offset, bool verify);
+    std::shared_ptr<const CachedFile> materialize(uint64_t offset) const;
+};
+
+#endif // SHARED_CACHE_H
@@ -0,0 +1,29 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+// NUMA layout from sysfs and thread placement, without libnuma
+namespace topology {
+// Parses a kernel CPU/node list such as "0-3,8,10-11"
+std::vector<int> parse_list(const std::string &list);
+
+// Nodes that have memory; {0} on machines without NUMA
+std::vector<int> memory_nodes();
+
+// CPUs belonging to a node; empty if unknown
+std::vector<int> node_cpus(int node);
+
+// Online CPUs; {0} if unknown
+std::vector<int> online_cpus();
+
+// Pins the calling thread to one CPU. Returns false on failure.
+bool bind_cpu(int cpu);
+
+// Pins the calling thread to a node's CPUs and prefers that node for its
+// future allocations. Returns false if either step failed.
+bool bind_thread(int node);
+} // namespace topology
+
+#endif // TOPOLOGY_H
@@ -0,0 +1,60 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <string>
+
+// Per-phase request timing. Tracepoints are compiled in only with
+// -DSTATIC_SERVER_TRACING (cmake -DENABLE_TRACING=ON); otherwise
+// TRACE_SCOPE expands to nothing. Each thread records into its own ring
+// of TSC timestamps, dumped as Chrome trace-event JSON (chrome://tracing,
+// Perfetto). With <sys/sdt.h>, every phase also fires the USDT probe
+// static_server:phase(phase, fd, cycles) for perf and bpftrace.
+namespace trace {
+enum Phase { ACCEPT, READ, PARSE, LOOKUP, SEND, PHASE_COUNT };
+
+const char *phase_name(Phase phase);
+
+uint64_t monotonic_ns();
+
+// Timestamp counter: rdtsc on x86, the monotonic clock elsewhere
+inline uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t low, high;
+    __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+    return (static_cast<uint64_t>(high) << 32) | low;
+#else
+    return monotonic_ns();
+#endif
+}
+
+// Appends to the calling thread's ring, overwriting the oldest events
+void record(Phase phase, int fd, uint64_t start, uint64_t end);
+
+// All rings as a Chrome trace-event JSON document
+std::string dump_json();
+bool write_json(const std::string &path);
+
+// Records the enclosing scope as one phase
+class Scope {
+  public:
+    Scope(Phase phase, int fd) : phase(phase), fd(fd), start(now()) {}
+    ~Scope() { record(phase, fd, start, now()); }
+
+  private:
+    Phase phase;
+    int fd;
+    uint64_t start;
+};
+} // namespace trace
+
+#ifdef STATIC_SERVER_TRACING
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(phase, fd)                                                 \
+    trace::Scope TRACE_CONCAT(trace_scope_, __LINE__)(trace::phase, fd)
+#else
+#define TRACE_SCOPE(phase, fd) ((void)0)
+#endif
+
+#endif // TRACE_H
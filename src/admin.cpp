@@ -0,0 +1,64 @@
+#include "../include/admin.h"
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace admin {
+Control *map_control() {
+    void *block = mmap(nullptr, sizeof(Control), PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (block == MAP_FAILED) {
+        throw std::runtime_error("Failed to map control block");
+    }
+    return new (block) Control();
+}
+
+void unmap_control(Control *control) {
+    if (control != nullptr) {
+        control->~Control();
+        munmap(control, sizeof(Control));
+    }
+}
+
+int open_socket(const std::string &path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Invalid admin socket path: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create admin socket");
+    }
+    unlink(path.c_str()); // Remove a stale socket from a previous run
+
+    // Created owner-only; the admin commands are not for other users
+    mode_t mask = umask(077);
+    int bound = bind(fd, (struct sockaddr *)&address, sizeof(address));
+    umask(mask);
+    if (bound < 0 || listen(fd, 8) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to listen on admin socket " + path);
+    }
+    return fd;
+}
+
+std::vector<std::string> split(const std::string &line) {
+    std::vector<std::string> words;
+    size_t begin = line.find_first_not_of(" \t\r");
+    while (begin != std::string::npos) {
+        size_t end = line.find_first_of(" \t\r", begin);
+        words.push_back(line.substr(begin, end - begin));
+        begin = line.find_first_not_of(" \t\r", end);
+    }
+    return words;
+}
+} // namespace admin
@@ -0,0 +1,108 @@
+#include "../include/cache_policy.h"
+#include <stdexcept>
+
+CachePolicy::CachePolicy(const std::vector<CacheRule> &rules)
+    : rules(rules) {
+    Node root;
+    root.exact = -1;
+    root.prefix = -1;
+    nodes.push_back(root);
+
+    // The first rule for a given pattern wins
+    for (size_t i = 0; i < rules.size(); ++i) {
+        const std::string &pattern = rules[i].pattern;
+        int index = static_cast<int>(i);
+
+        if (pattern.size() > 2 && pattern.compare(0, 2, "*.") == 0 &&
+            pattern.find_first_of("*/", 1) == std::string::npos) {
+            extensions.insert(std::make_pair(pattern.substr(1), index));
+        } else if (pattern.size() > 1 && pattern[0] == '/' &&
+                   pattern.compare(pattern.size() - 2, 2, "/*") == 0 &&
+                   pattern.find('*') == pattern.size() - 1) {
+            int node = insert_path(pattern.substr(0, pattern.size() - 1));
+            if (nodes[node].prefix < 0) {
+                nodes[node].prefix = index;
+            }
+        } else if (!pattern.empty() && pattern[0] == '/' &&
+                   pattern.find('*') == std::string::npos) {
+            int node = insert_path(pattern);
+            if (nodes[node].exact < 0) {
+                nodes[node].exact = index;
+            }
+        } else {
+            throw std::runtime_error("Unsupported cache rule pattern: " +
+                                     pattern);
+        }
+    }
+}
+
+int CachePolicy::insert_path(const std::string &path) {
+    int node = 0;
+    for (size_t i = 0; i < path.size(); ++i) {
+        int next = -1;
+        std::vector<std::pair<char, int>> &children = nodes[node].children;
+        for (size_t c = 0; c < children.size(); ++c) {
+            if (children[c].first == path[i]) {
+                next = children[c].second;
+                break;
+            }
+        }
+        if (next < 0) {
+            Node child;
+            child.exact = -1;
+            child.prefix = -1;
+            next = static_cast<int>(nodes.size());
+            nodes[node].children.push_back(std::make_pair(path[i], next));
+            nodes.push_back(child);
+        }
+        node = next;
+    }
+    return node;
+}
+
+const CacheRule *CachePolicy::match(const std::string &path) const {
+    if (rules.empty()) {
+        return nullptr;
+    }
+
+    // Walk the trie, remembering the deepest prefix rule passed
+    int node = 0;
+    int best_prefix = nodes[0].prefix;
+    size_t i = 0;
+    for (; i < path.size(); ++i) {
+        int next = -1;
+        const std::vector<std::pair<char, int>> &children =
+            nodes[node].children;
+        for (size_t c = 0; c < children.size(); ++c) {
+            if (children[c].first == path[i]) {
+                next = children[c].second;
+                break;
+            }
+        }
+        if (next < 0) {
+            break;
+        }
+        node = next;
+        if (nodes[node].prefix >= 0) {
+            best_prefix = nodes[node].prefix;
+        }
+    }
+    if (i == path.size() && nodes[node].exact >= 0) {
+        return &rules[nodes[node].exact];
+    }
+    if (best_prefix >= 0) {
+        return &rules[best_prefix];
+    }
+
+    // Extension of the last path segment
+    if (!extensions.empty()) {
+        size_t dot = path.find_last_of("./");
+        if (dot != std::string::npos && path[dot] == '.') {
+            auto it = extensions.find(path.substr(dot));
+            if (it != extensions.end()) {
+                return &rules[it->second];
+            }
+        }
+    }
+    return nullptr;
+}
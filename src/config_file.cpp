@@ -0,0 +1,625 @@
+#include "../include/config_file.h"
+#include "../include/file_utils.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+const long long MAX_EXPIRES = 10LL * 365 * 24 * 3600; // About ten years
+
+struct JsonValue {
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    Type type;
+    bool boolean;
+    double number;
+    std::string string; // Also the source text of a NUMBER
+    std::vector<JsonValue> array;
+    std::map<std::string, JsonValue> object;
+
+    JsonValue() : type(NUL), boolean(false), number(0) {}
+};
+
+// Minimal recursive-descent JSON parser; errors report the line number
+class JsonParser {
+  public:
+    explicit JsonParser(const std::string &text) : text(text), pos(0) {}
+
+    JsonValue parse() {
+        JsonValue value = parse_value(0);
+        skip_whitespace();
+        if (pos != text.size()) {
+            fail("Trailing characters");
+        }
+        return value;
+    }
+
+  private:
+    const std::string &text;
+    size_t pos;
+
+    void fail(const std::string &message) const {
+        size_t line = 1;
+        for (size_t i = 0; i < pos && i < text.size(); ++i) {
+            line += text[i] == '\n' ? 1 : 0;
+        }
+        throw std::runtime_error("Config line " + std::to_string(line) +
+                                 ": " + message);
+    }
+
+    void skip_whitespace() {
+        while (pos < text.size() &&
+               (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' ||
+                text[pos] == '\r')) {
+            ++pos;
+        }
+    }
+
+    void expect(char c) {
+        skip_whitespace();
+        if (pos >= text.size() || text[pos] != c) {
+            fail(std::string("Expected '") + c + "'");
+        }
+        ++pos;
+    }
+
+    bool is_digit() const {
+        return pos < text.size() &&
+               isdigit(static_cast<unsigned char>(text[pos]));
+    }
+
+    void skip_digits() {
+        while (is_digit()) {
+            ++pos;
+        }
+    }
+
+    bool consume(const char *literal) {
+        size_t length = strlen(literal);
+        if (text.compare(pos, length, literal) == 0) {
+            pos += length;
+            return true;
+        }
+        return false;
+    }
+
+    JsonValue parse_value(int depth) {
+        if (depth > 32) {
+            fail("Nesting too deep");
+        }
+        skip_whitespace();
+        if (pos >= text.size()) {
+            fail("Unexpected end of input");
+        }
+
+        JsonValue value;
+        char c = text[pos];
+        if (c == '{') {
+            ++pos;
+            value.type = JsonValue::OBJECT;
+            skip_whitespace();
+            if (pos < text.size() && text[pos] == '}') {
+                ++pos;
+                return value;
+            }
+            while (true) {
+                skip_whitespace();
+                std::string key = parse_string();
+                expect(':');
+                value.object[key] = parse_value(depth + 1);
+                skip_whitespace();
+                if (pos < text.size() && text[pos] == ',') {
+                    ++pos;
+                    continue;
+                }
+                expect('}');
+                return value;
+            }
+        }
+        if (c == '[') {
+            ++pos;
+            value.type = JsonValue::ARRAY;
+            skip_whitespace();
+            if (pos < text.size() && text[pos] == ']') {
+                ++pos;
+                return value;
+            }
+            while (true) {
+                value.array.push_back(parse_value(depth + 1));
+                skip_whitespace();
+                if (pos < text.size() && text[pos] == ',') {
+                    ++pos;
+                    continue;
+                }
+                expect(']');
+                return value;
+            }
+        }
+        if (c == '"') {
+            value.type = JsonValue::STRING;
+            value.string = parse_string();
+            return value;
+        }
+        if (consume("true")) {
+            value.type = JsonValue::BOOLEAN;
+            value.boolean = true;
+            return value;
+        }
+        if (consume("false")) {
+            value.type = JsonValue::BOOLEAN;
+            return value;
+        }
+        if (consume("null")) {
+            return value;
+        }
+
+        // JSON number grammar only, so strtod never sees inf, nan or hex
+        size_t start = pos;
+        if (text[pos] == '-') {
+            ++pos;
+        }
+        if (!is_digit()) {
+            fail("Unexpected character");
+        }
+        if (text[pos] == '0') {
+            ++pos;
+        } else {
+            skip_digits();
+        }
+        if (pos < text.size() && text[pos] == '.') {
+            ++pos;
+            if (!is_digit()) {
+                fail("Malformed number");
+            }
+            skip_digits();
+        }
+        if (pos < text.size() && (text[pos] == 'e' || text[pos] == 'E')) {
+            ++pos;
+            if (pos < text.size() && (text[pos] == '+' || text[pos] == '-')) {
+                ++pos;
+            }
+            if (!is_digit()) {
+                fail("Malformed number");
+            }
+            skip_digits();
+        }
+        value.type = JsonValue::NUMBER;
+        value.string = text.substr(start, pos - start);
+        value.number = strtod(value.string.c_str(), nullptr);
+        if (!std::isfinite(value.number)) {
+            fail("Number out of range");
+        }
+        return value;
+    }
+
+    unsigned long parse_hex4() {
+        if (pos + 4 > text.size()) {
+            fail("Truncated \\u escape");
+        }
+        for (size_t i = pos; i < pos + 4; ++i) {
+            if (!isxdigit(static_cast<unsigned char>(text[i]))) {
+                fail("Invalid \\u escape");
+            }
+        }
+        unsigned long code = strtoul(text.substr(pos, 4).c_str(), nullptr, 16);
+        pos += 4;
+        return code;
+    }
+
+    std::string parse_string() {
+        if (pos >= text.size() || text[pos] != '"') {
+            fail("Expected a string");
+        }
+        ++pos;
+        std::string out;
+        while (pos < text.size() && text[pos] != '"') {
+            char c = text[pos++];
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos >= text.size()) {
+                break;
+            }
+            char escape = text[pos++];
+            switch (escape) {
+            case 'n':
+                out += '\n';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'u': {
+                // Characters outside the Basic Multilingual Plane come as
+                // a surrogate pair; either half alone is an error
+                unsigned long code = parse_hex4();
+                if (code >= 0xdc00 && code <= 0xdfff) {
+                    fail("Unpaired surrogate in \\u escape");
+                }
+                if (code >= 0xd800 && code <= 0xdbff) {
+                    if (!consume("\\u")) {
+                        fail("Unpaired surrogate in \\u escape");
+                    }
+                    unsigned long low = parse_hex4();
+                    if (low < 0xdc00 || low > 0xdfff) {
+                        fail("Unpaired surrogate in \\u escape");
+                    }
+                    code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+                }
+                // Encoded as UTF-8
+                if (code < 0x80) {
+                    out += static_cast<char>(code);
+                } else if (code < 0x800) {
+                    out += static_cast<char>(0xc0 | (code >> 6));
+                    out += static_cast<char>(0x80 | (code & 0x3f));
+                } else if (code < 0x10000) {
+                    out += static_cast<char>(0xe0 | (code >> 12));
+                    out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                    out += static_cast<char>(0x80 | (code & 0x3f));
+                } else {
+                    out += static_cast<char>(0xf0 | (code >> 18));
+                    out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+                    out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                    out += static_cast<char>(0x80 | (code & 0x3f));
+                }
+                break;
+            }
+            case '"':
+            case '\\':
+            case '/':
+                out += escape;
+                break;
+            default:
+                fail(std::string("Invalid escape '\\") + escape + "'");
+            }
+        }
+        if (pos >= text.size()) {
+            fail("Unterminated string");
+        }
+        ++pos;
+        return out;
+    }
+};
+
+void check_type(const JsonValue &value, JsonValue::Type type,
+                const std::string &key) {
+    static const char *NAMES[] = {"null",   "a boolean", "a number",
+                                  "a string", "an array", "an object"};
+    if (value.type != type) {
+        throw std::runtime_error("Config key '" + key + "' must be " +
+                                 NAMES[type]);
+    }
+}
+
+std::string get_string(const JsonValue &value, const std::string &key) {
+    check_type(value, JsonValue::STRING, key);
+    return value.string;
+}
+
+// Fractional settings are rates, bursts and ratios, none of which can be
+// negative
+double get_number(const JsonValue &value, const std::string &key) {
+    check_type(value, JsonValue::NUMBER, key);
+    if (value.number < 0) {
+        throw std::runtime_error("Config key '" + key +
+                                 "' must not be negative");
+    }
+    return value.number;
+}
+
+// Integer settings must be written without a fraction or exponent and
+// fit the range of the field they set
+long long get_integer(const JsonValue &value, const std::string &key,
+                      long long min, long long max) {
+    check_type(value, JsonValue::NUMBER, key);
+    const std::string &text = value.string;
+    errno = 0;
+    char *end = nullptr;
+    long long number = strtoll(text.c_str(), &end, 10);
+    if (*end != '\0' || errno == ERANGE || number < min || number > max) {
+        throw std::runtime_error("Config key '" + key +
+                                 "' must be an integer from " +
+                                 std::to_string(min) + " to " +
+                                 std::to_string(max));
+    }
+    return number;
+}
+
+int get_int(const JsonValue &value, const std::string &key) {
+    return static_cast<int>(get_integer(value, key, 0, INT_MAX));
+}
+
+unsigned get_unsigned(const JsonValue &value, const std::string &key) {
+    return static_cast<unsigned>(get_integer(value, key, 0, UINT_MAX));
+}
+
+size_t get_size(const JsonValue &value, const std::string &key) {
+    const long long max = static_cast<long long>(
+        std::min<unsigned long long>(SIZE_MAX, LLONG_MAX));
+    return static_cast<size_t>(get_integer(value, key, 0, max));
+}
+
+int get_port(const JsonValue &value, const std::string &key) {
+    return static_cast<int>(get_integer(value, key, 0, 65535));
+}
+
+bool get_bool(const JsonValue &value, const std::string &key) {
+    check_type(value, JsonValue::BOOLEAN, key);
+    return value.boolean;
+}
+
+void unknown_key(const std::string &section, const std::string &key) {
+    throw std::runtime_error("Unknown config key '" + key + "' in " +
+                             section);
+}
+
+std::string parse_reuseport(const JsonValue &value) {
+    std::string mode = get_string(value, "reuseport");
+    if (mode != "off" && mode != "hash" && mode != "cpu") {
+        throw std::runtime_error("reuseport must be \"off\", \"hash\" or "
+                                 "\"cpu\"");
+    }
+    return mode;
+}
+
+ListenerConfig parse_listener(const JsonValue &value) {
+    check_type(value, JsonValue::OBJECT, "listen[]");
+    ListenerConfig listener;
+    for (auto it = value.object.begin(); it != value.object.end(); ++it) {
+        const std::string &key = it->first;
+        if (key == "address")
+            listener.address = get_string(it->second, key);
+        else if (key == "port")
+            listener.port = get_port(it->second, key);
+        else if (key == "v6_only")
+            listener.v6_only = get_bool(it->second, key);
+        else if (key == "backlog")
+            listener.backlog = get_int(it->second, key);
+        else if (key == "defer_accept")
+            listener.defer_accept = get_int(it->second, key);
+        else if (key == "fastopen")
+            listener.fastopen = get_int(it->second, key);
+        else if (key == "nodelay")
+            listener.nodelay = get_bool(it->second, key);
+        else if (key == "send_buffer")
+            listener.send_buffer = get_int(it->second, key);
+        else if (key == "reuseport")
+            listener.reuseport = parse_reuseport(it->second);
+        else
+            unknown_key("listen", key);
+    }
+    return listener;
+}
+
+RateLimitConfig parse_rate_limit(const JsonValue &value) {
+    check_type(value, JsonValue::OBJECT, "rate_limit");
+    RateLimitConfig limit;
+    for (auto it = value.object.begin(); it != value.object.end(); ++it) {
+        const std::string &key = it->first;
+        if (key == "requests_per_second")
+            limit.requests_per_second = get_number(it->second, key);
+        else if (key == "request_burst")
+            limit.request_burst = get_number(it->second, key);
+        else if (key == "bytes_per_second")
+            limit.bytes_per_second = get_number(it->second, key);
+        else if (key == "byte_burst")
+            limit.byte_burst = get_number(it->second, key);
+        else if (key == "max_connections")
+            limit.max_connections = get_unsigned(it->second, key);
+        else if (key == "prefix_multiplier")
+            limit.prefix_multiplier = get_number(it->second, key);
+        else if (key == "table_size")
+            limit.table_size = get_size(it->second, key);
+        else
+            unknown_key("rate_limit", key);
+    }
+    return limit;
+}
+
+MemoryConfig parse_memory(const JsonValue &value) {
+    check_type(value, JsonValue::OBJECT, "memory");
+    MemoryConfig memory;
+    for (auto it = value.object.begin(); it != value.object.end(); ++it) {
+        const std::string &key = it->first;
+        if (key == "huge_pages")
+            memory.huge_pages = get_bool(it->second, key);
+        else if (key == "numa")
+            memory.numa = get_string(it->second, key);
+        else
+            unknown_key("memory", key);
+    }
+    if (memory.numa != "off" && memory.numa != "replicate" &&
+        memory.numa != "interleave") {
+        throw std::runtime_error("numa must be \"off\", \"replicate\" or "
+                                 "\"interleave\"");
+    }
+    return memory;
+}
+
+HotSetConfig parse_hot_set(const JsonValue &value) {
+    check_type(value, JsonValue::OBJECT, "hot_set");
+    HotSetConfig hot;
+    for (auto it = value.object.begin(); it != value.object.end(); ++it) {
+        const std::string &key = it->first;
+        if (key == "file")
+            hot.file = get_string(it->second, key);
+        else if (key == "interval")
+            hot.interval = get_unsigned(it->second, key);
+        else if (key == "max_entries")
+            hot.max_entries = get_size(it->second, key);
+        else if (key == "warmup_threads")
+            hot.warmup_threads = get_unsigned(it->second, key);
+        else
+            unknown_key("hot_set", key);
+    }
+    return hot;
+}
+
+std::vector<CacheRule> parse_cache_rules(const JsonValue &value) {
+    check_type(value, JsonValue::ARRAY, "cache_rules");
+    std::vector<CacheRule> rules;
+    for (size_t i = 0; i < value.array.size(); ++i) {
+        const JsonValue &entry = value.array[i];
+        check_type(entry, JsonValue::OBJECT, "cache_rules[]");
+        CacheRule rule;
+        for (auto it = entry.object.begin(); it != entry.object.end(); ++it) {
+            const std::string &key = it->first;
+            if (key == "match")
+                rule.pattern = get_string(it->second, key);
+            else if (key == "cache_control")
+                rule.cache_control = get_string(it->second, key);
+            else if (key == "expires")
+                // Clamped so the date stays far from time_t overflow
+                rule.expires = static_cast<long>(
+                    std::min(get_integer(it->second, key, -1, LONG_MAX),
+                             MAX_EXPIRES));
+            else
+                unknown_key("cache_rules", key);
+        }
+        if (rule.pattern.empty()) {
+            throw std::runtime_error("Cache rule without 'match'");
+        }
+        rules.push_back(rule);
+    }
+    return rules;
+}
+
+std::map<int, std::string> parse_error_pages(const JsonValue &value) {
+    check_type(value, JsonValue::OBJECT, "error_pages");
+    std::map<int, std::string> pages;
+    for (auto it = value.object.begin(); it != value.object.end(); ++it) {
+        const std::string &key = it->first;
+        bool digits = key.size() == 3 && isdigit((unsigned char)key[0]) &&
+                      isdigit((unsigned char)key[1]) &&
+                      isdigit((unsigned char)key[2]);
+        int status = digits ? atoi(key.c_str()) : 0;
+        if (status < 400 || status > 599) {
+            throw std::runtime_error("Invalid error page status: " +
+                                     it->first);
+        }
+        pages[status] = get_string(it->second, it->first);
+    }
+    return pages;
+}
+
+bool parse_compression(const JsonValue &value) {
+    std::string mode = get_string(value, "compression");
+    if (mode != "off" && mode != "precompressed") {
+        throw std::runtime_error("compression must be \"off\" or "
+                                 "\"precompressed\"");
+    }
+    return mode == "precompressed";
+}
+
+VirtualHostConfig parse_virtual_host(const JsonValue &value) {
+    check_type(value, JsonValue::OBJECT, "virtual_hosts[]");
+    VirtualHostConfig host;
+    for (auto it = value.object.begin(); it != value.object.end(); ++it) {
+        const std::string &key = it->first;
+        if (key == "server_names") {
+            check_type(it->second, JsonValue::ARRAY, key);
+            for (size_t i = 0; i < it->second.array.size(); ++i) {
+                host.server_names.push_back(
+                    get_string(it->second.array[i], key));
+            }
+        } else if (key == "root")
+            host.root_directory = get_string(it->second, key);
+        else if (key == "cache_size")
+            host.cache_size = get_size(it->second, key);
+        else if (key == "compression")
+            host.precompressed = parse_compression(it->second);
+        else if (key == "error_pages")
+            host.error_pages = parse_error_pages(it->second);
+        else if (key == "cache_rules")
+            host.cache_rules = parse_cache_rules(it->second);
+        else
+            unknown_key("virtual_hosts", key);
+    }
+    if (host.server_names.empty() || host.root_directory.empty()) {
+        throw std::runtime_error(
+            "Virtual hosts need 'server_names' and 'root'");
+    }
+    return host;
+}
+} // namespace
+
+ServerConfig parse_config(const std::string &text) {
+    JsonValue root = JsonParser(text).parse();
+    check_type(root, JsonValue::OBJECT, "top level");
+
+    ServerConfig config;
+    for (auto it = root.object.begin(); it != root.object.end(); ++it) {
+        const std::string &key = it->first;
+        const JsonValue &value = it->second;
+        if (key == "port") {
+            config.port = get_port(value, key);
+        } else if (key == "root") {
+            config.root_directory = get_string(value, key);
+        } else if (key == "cache_size") {
+            config.cache_size = get_size(value, key);
+        } else if (key == "max_cached_file_size") {
+            config.max_cached_file_size = get_size(value, key);
+        } else if (key == "listen") {
+            check_type(value, JsonValue::ARRAY, key);
+            for (size_t i = 0; i < value.array.size(); ++i) {
+                config.listeners.push_back(parse_listener(value.array[i]));
+            }
+        } else if (key == "rate_limit") {
+            config.rate_limit = parse_rate_limit(value);
+        } else if (key == "trace_file") {
+            config.trace_file = get_string(value, key);
+        } else if (key == "workers") {
+            config.workers = get_unsigned(value, key);
+        } else if (key == "processes") {
+            config.processes = get_unsigned(value, key);
+        } else if (key == "admin_socket") {
+            config.admin_socket = get_string(value, key);
+        } else if (key == "log_sample") {
+            config.log_sample = get_unsigned(value, key);
+        } else if (key == "io_budget") {
+            config.io_budget = get_size(value, key);
+        } else if (key == "shared_cache_size") {
+            config.shared_cache_size = get_size(value, key);
+        } else if (key == "memory") {
+            config.memory = parse_memory(value);
+        } else if (key == "hot_set") {
+            config.hot_set = parse_hot_set(value);
+        } else if (key == "compression") {
+            config.precompressed = parse_compression(value);
+        } else if (key == "error_pages") {
+            config.error_pages = parse_error_pages(value);
+        } else if (key == "cache_rules") {
+            config.cache_rules = parse_cache_rules(value);
+        } else if (key == "virtual_hosts") {
+            check_type(value, JsonValue::ARRAY, key);
+            for (size_t i = 0; i < value.array.size(); ++i) {
+                config.virtual_hosts.push_back(
+                    parse_virtual_host(value.array[i]));
+            }
+        } else {
+            unknown_key("top level", key);
+        }
+    }
+    return config;
+}
+
+ServerConfig load_config_file(const std::string &path) {
+    return parse_config(file_utils::read_file(path));
+}
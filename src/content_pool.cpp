@@ -0,0 +1,241 @@
+#include "../include/content_pool.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <linux/mempolicy.h>
+#include <list>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace {
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+const size_t CHUNK_SIZE = 4 * HUGE_PAGE_SIZE;
+const size_t SLICE_ALIGNMENT = 64; // Bodies start on their own cache line
+
+size_t round_up(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// Slices are cut at the front of a chunk by a bump offset and recycled
+// through per-size free lists
+struct Chunk {
+    char *base;
+    size_t size;
+    size_t used; // Bytes handed out from the front
+    size_t live; // Slices not yet released
+
+    Chunk(char *base, size_t size)
+        : base(base), size(size), used(0), live(0) {}
+    Chunk(const Chunk &) = delete;
+    Chunk &operator=(const Chunk &) = delete;
+    ~Chunk() { munmap(base, size); }
+};
+
+struct Slot {
+    char *at;
+    size_t size;
+    std::list<Chunk>::iterator chunk;
+};
+
+// Slot sizes step by at most a quarter of the body size, so rounding up
+// wastes little, and every slot starts on a cache line
+size_t slot_size(size_t size) {
+    size_t step = SLICE_ALIGNMENT;
+    while (step * 8 <= size) {
+        step <<= 1;
+    }
+    return round_up(size, step);
+}
+} // namespace
+
+struct ContentPool::State {
+    bool huge_pages;
+    int node;
+    std::vector<int> nodes;
+    size_t max_bytes;
+    bool warned;
+
+    mutable std::mutex mutex;
+    std::list<Chunk> chunks;
+    std::list<Chunk>::iterator current; // Chunk being carved, or end()
+    std::unordered_map<size_t, std::vector<Slot>> free_slots;
+    size_t mapped;
+
+    State(bool huge_pages, int node, const std::vector<int> &nodes,
+          size_t max_bytes)
+        : huge_pages(huge_pages), node(node), nodes(nodes),
+          max_bytes(max_bytes), warned(false), current(chunks.end()),
+          mapped(0) {}
+
+    bool allocate(size_t size, Slot &slot);
+    void release(const Slot &slot);
+    void retire(std::list<Chunk>::iterator chunk);
+    bool map_chunk(size_t size);
+};
+
+// Deleter of a slice's shared pointer
+struct ContentPool::Release {
+    std::shared_ptr<State> state;
+    Slot slot;
+
+    void operator()(const char *) const { state->release(slot); }
+};
+
+ContentPool::ContentPool(bool huge_pages, int node,
+                         const std::vector<int> &nodes, size_t max_bytes)
+    : state(std::make_shared<State>(huge_pages, node, nodes, max_bytes)) {}
+
+Content ContentPool::store(const char *data, size_t size) {
+    if (size == 0) {
+        return Content();
+    }
+    Slot slot;
+    if (!state->allocate(size, slot)) {
+        return Content(std::string(data, size));
+    }
+
+    // Copying outside the lock; the slot belongs to this caller only
+    memcpy(slot.at, data, size);
+    Release release = {state, slot};
+    return Content(std::shared_ptr<const char>(slot.at, release), size);
+}
+
+size_t ContentPool::mapped_bytes() const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->mapped;
+}
+
+bool ContentPool::State::allocate(size_t size, Slot &slot) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (size > CHUNK_SIZE / 4) {
+        // Large bodies get a mapping of their own so they do not pin
+        // a shared chunk
+        if (!map_chunk(round_up(size, HUGE_PAGE_SIZE))) {
+            return false;
+        }
+        std::list<Chunk>::iterator chunk = std::prev(chunks.end());
+        chunk->used = chunk->size;
+        chunk->live = 1;
+        slot.at = chunk->base;
+        slot.size = chunk->size;
+        slot.chunk = chunk;
+        return true;
+    }
+
+    size_t needed = slot_size(size);
+    std::vector<Slot> &reusable = free_slots[needed];
+    if (!reusable.empty()) {
+        slot = reusable.back();
+        reusable.pop_back();
+        ++slot.chunk->live;
+        return true;
+    }
+    if (current == chunks.end() || current->used + needed > current->size) {
+        std::list<Chunk>::iterator previous = current;
+        if (!map_chunk(CHUNK_SIZE)) {
+            return false;
+        }
+        current = std::prev(chunks.end());
+        if (previous != chunks.end() && previous->live == 0) {
+            retire(previous);
+        }
+    }
+    slot.at = current->base + current->used;
+    slot.size = needed;
+    slot.chunk = current;
+    current->used += needed;
+    ++current->live;
+    return true;
+}
+
+void ContentPool::State::release(const Slot &slot) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--slot.chunk->live == 0 && slot.chunk != current) {
+        retire(slot.chunk);
+    } else {
+        free_slots[slot.size].push_back(slot);
+    }
+}
+
+void ContentPool::State::retire(std::list<Chunk>::iterator chunk) {
+    // Its free slots go with it
+    for (auto it = free_slots.begin(); it != free_slots.end(); ++it) {
+        std::vector<Slot> &slots = it->second;
+        slots.erase(std::remove_if(slots.begin(), slots.end(),
+                                   [chunk](const Slot &slot) {
+                                       return slot.chunk == chunk;
+                                   }),
+                    slots.end());
+    }
+    mapped -= chunk->size;
+    chunks.erase(chunk);
+}
+
+bool ContentPool::State::map_chunk(size_t size) {
+    // The first mapping is always allowed, however small the limit
+    if (max_bytes != 0 && mapped != 0 && mapped + size > max_bytes) {
+        return false;
+    }
+    void *base = MAP_FAILED;
+    if (huge_pages) {
+        // Reserved hugetlbfs pages first, then transparent huge pages
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (base == MAP_FAILED && !warned) {
+            std::cerr << "Warning: no reserved huge pages, using "
+                         "transparent huge pages"
+                      << std::endl;
+            warned = true;
+        }
+    }
+    if (base == MAP_FAILED) {
+        // Over-map so the chunk can start on a huge page boundary
+        size_t padded = huge_pages ? size + HUGE_PAGE_SIZE : size;
+        char *raw = static_cast<char *>(mmap(nullptr, padded,
+                                             PROT_READ | PROT_WRITE,
+                                             MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                                             0));
+        if (raw == MAP_FAILED) {
+            return false;
+        }
+        char *aligned = raw;
+        if (huge_pages) {
+            aligned = reinterpret_cast<char *>(round_up(
+                reinterpret_cast<uintptr_t>(raw), HUGE_PAGE_SIZE));
+            if (aligned > raw) {
+                munmap(raw, aligned - raw);
+            }
+            size_t tail = padded - size - (aligned - raw);
+            if (tail > 0) {
+                munmap(aligned + size, tail);
+            }
+            madvise(aligned, size, MADV_HUGEPAGE);
+        }
+        base = aligned;
+    }
+
+    // Place the pages before the first touch faults them in
+    if (node != ANY_NODE) {
+        unsigned long mask[16] = {0};
+        const size_t bits = sizeof(unsigned long) * 8;
+        int mode = node == INTERLEAVE ? MPOL_INTERLEAVE : MPOL_PREFERRED;
+        if (node == INTERLEAVE) {
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                if (nodes[i] >= 0 && nodes[i] < static_cast<int>(16 * bits)) {
+                    mask[nodes[i] / bits] |= 1UL << (nodes[i] % bits);
+                }
+            }
+        } else if (node < static_cast<int>(16 * bits)) {
+            mask[node / bits] |= 1UL << (node % bits);
+        }
+        syscall(SYS_mbind, base, size, mode, mask, 16 * bits, 0);
+    }
+    chunks.emplace_back(static_cast<char *>(base), size);
+    mapped += size;
+    return true;
+}
@@ -0,0 +1,164 @@
+#include "../include/content_store.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+const uint64_t PRIME1 = 0x9E3779B185EBCA87ULL;
+const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t PRIME3 = 0x165667B19E3779F9ULL;
+const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t PRIME5 = 0x27D4EB2F165667C5ULL;
+const size_t MIN_SWEEP = 1024;
+
+inline uint64_t rotl(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// Little-endian loads; memcpy compiles to a plain mov
+inline uint64_t read64(const char *p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint32_t read32(const char *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+inline uint64_t lane_round(uint64_t acc, uint64_t input) {
+    acc += input * PRIME2;
+    return rotl(acc, 31) * PRIME1;
+}
+
+inline uint64_t merge(uint64_t acc, uint64_t lane) {
+    acc ^= lane_round(0, lane);
+    return acc * PRIME1 + PRIME4;
+}
+} // namespace
+
+uint64_t content_hash(const char *data, size_t size) {
+    const char *p = data;
+    const char *end = data + size;
+    uint64_t hash;
+
+    // Four independent lanes keep the multipliers busy
+    if (size >= 32) {
+        uint64_t v1 = PRIME1 + PRIME2;
+        uint64_t v2 = PRIME2;
+        uint64_t v3 = 0;
+        uint64_t v4 = 0 - PRIME1;
+        const char *limit = end - 32;
+        do {
+            v1 = lane_round(v1, read64(p));
+            v2 = lane_round(v2, read64(p + 8));
+            v3 = lane_round(v3, read64(p + 16));
+            v4 = lane_round(v4, read64(p + 24));
+            p += 32;
+        } while (p <= limit);
+        hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        hash = merge(hash, v1);
+        hash = merge(hash, v2);
+        hash = merge(hash, v3);
+        hash = merge(hash, v4);
+    } else {
+        hash = PRIME5;
+    }
+    hash += static_cast<uint64_t>(size);
+
+    for (; p + 8 <= end; p += 8) {
+        hash ^= lane_round(0, read64(p));
+        hash = rotl(hash, 27) * PRIME1 + PRIME4;
+    }
+    if (p + 4 <= end) {
+        hash ^= static_cast<uint64_t>(read32(p)) * PRIME1;
+        hash = rotl(hash, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        hash ^= static_cast<uint64_t>(static_cast<unsigned char>(*p)) * PRIME5;
+        hash = rotl(hash, 11) * PRIME1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+std::string content_etag(uint64_t hash) {
+    char buffer[20];
+    snprintf(buffer, sizeof(buffer), "\"%016llx\"",
+             static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+ContentStore::ContentStore(ContentPool *pool)
+    : pool(pool), sweep_at(MIN_SWEEP), reused(0) {}
+
+Content ContentStore::intern(uint64_t hash, std::string bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Equal hashes are confirmed byte for byte before sharing
+    auto range = bodies.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        std::shared_ptr<const char> data = it->second.data.lock();
+        if (data && it->second.size == bytes.size() &&
+            memcmp(data.get(), bytes.data(), bytes.size()) == 0) {
+            ++reused;
+            return Content(data, bytes.size());
+        }
+    }
+
+    // Expired references are dropped in batches, as the table doubles
+    if (bodies.size() >= sweep_at) {
+        for (auto it = bodies.begin(); it != bodies.end();) {
+            if (it->second.data.expired()) {
+                it = bodies.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        sweep_at = std::max(MIN_SWEEP, bodies.size() * 2);
+    }
+
+    Body body;
+    body.size = bytes.size();
+    Content content;
+    std::shared_ptr<const char> data;
+    if (pool != nullptr) {
+        content = pool->store(bytes.data(), bytes.size());
+        data = content.slice();
+    }
+    if (!data) {
+        // Heap bodies are shared strings, aliased as their bytes
+        std::shared_ptr<std::string> owner =
+            std::make_shared<std::string>(std::move(bytes));
+        data = std::shared_ptr<const char>(owner, owner->data());
+        content = Content(data, owner->size());
+    }
+    body.data = data;
+    bodies.insert(std::make_pair(hash, body));
+    return content;
+}
+
+ContentPool *ContentStore::placement() const { return pool; }
+
+size_t ContentStore::entry_count() const {
+    // Expired entries linger until the next sweep; count live ones only
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t live = 0;
+    for (auto it = bodies.begin(); it != bodies.end(); ++it) {
+        live += !it->second.data.expired();
+    }
+    return live;
+}
+
+uint64_t ContentStore::deduplicated() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return reused;
+}
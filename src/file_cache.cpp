@@ -0,0 +1,222 @@
+#include "../include/file_cache.h"
+#include "../include/content_pool.h"
+#include "../include/hpack.h"
+#include <algorithm>
+#include <cctype>
+
+bool CachedFile::matches(const struct stat &st) const {
+    return st.st_dev == device && st.st_ino == inode && st.st_size == size &&
+           st.st_mtim.tv_sec == mtime.tv_sec &&
+           st.st_mtim.tv_nsec == mtime.tv_nsec;
+}
+
+const char *status_reason(int status) {
+    switch (status) {
+    case 200:
+        return "OK";
+    case 304:
+        return "Not Modified";
+    case 400:
+        return "Bad Request";
+    case 404:
+        return "Not Found";
+    case 405:
+        return "Method Not Allowed";
+    case 429:
+        return "Too Many Requests";
+    case 500:
+        return "Internal Server Error";
+    default:
+        return "Unknown";
+    }
+}
+
+std::shared_ptr<CachedFile>
+build_cached_file(int status, const std::string &content_type,
+                  Content body, const hpack::HeaderList &extra_headers,
+                  ContentPool *pool) {
+    std::shared_ptr<CachedFile> file(new CachedFile());
+    file->status = status;
+    file->content_type = content_type;
+    file->body = std::move(body);
+    file->device = 0;
+    file->inode = 0;
+    file->size = 0;
+    file->mtime.tv_sec = 0;
+    file->mtime.tv_nsec = 0;
+    file->stale_at = 0;
+    file->gzip_variant = false;
+    file->content_hash = 0;
+
+    std::string length = std::to_string(file->body.size());
+
+    file->http1_header = "HTTP/1.1 " + std::to_string(status) + " " +
+                         status_reason(status) + "\r\n";
+    if (!content_type.empty()) {
+        file->http1_header += "Content-Type: " + content_type + "\r\n";
+    }
+    // A 304 has no body, and its length would describe the cached one
+    if (status != 304) {
+        file->http1_header += "Content-Length: " + length + "\r\n";
+    }
+    for (size_t i = 0; i < extra_headers.size(); ++i) {
+        file->http1_header +=
+            extra_headers[i].first + ": " + extra_headers[i].second + "\r\n";
+    }
+    file->http1_header += "\r\n";
+
+    hpack::encode_header(file->hpack_header, ":status",
+                         std::to_string(status));
+    if (!content_type.empty()) {
+        hpack::encode_header(file->hpack_header, "content-type", content_type);
+    }
+    if (status != 304) {
+        hpack::encode_header(file->hpack_header, "content-length", length);
+    }
+    for (size_t i = 0; i < extra_headers.size(); ++i) {
+        std::string name = extra_headers[i].first;
+        for (size_t c = 0; c < name.size(); ++c) {
+            name[c] = static_cast<char>(
+                tolower(static_cast<unsigned char>(name[c])));
+        }
+        hpack::encode_header(file->hpack_header, name,
+                             extra_headers[i].second);
+    }
+    prepare_packet(*file, pool);
+    return file;
+}
+
+void prepare_packet(CachedFile &file, ContentPool *pool) {
+    file.packet = Content();
+    if (file.body.empty() || file.body.size() > PACKET_BODY_LIMIT) {
+        return;
+    }
+    std::string packet;
+    packet.reserve(file.http1_header.size() + file.body.size());
+    packet = file.http1_header;
+    packet.append(file.body.data(), file.body.size());
+    file.packet = pool ? pool->store(packet.data(), packet.size())
+                       : Content(std::move(packet));
+}
+
+size_t cached_size(const CachedFile &file) {
+    return file.body.size() + file.content_type.size() +
+           file.http1_header.size() + file.hpack_header.size() +
+           file.packet.size();
+}
+
+FileCache::FileCache(size_t max_bytes)
+    : max_bytes(max_bytes), current_bytes(0) {}
+
+std::shared_ptr<const CachedFile> FileCache::find(const std::string &key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) {
+        return std::shared_ptr<const CachedFile>();
+    }
+    lru.splice(lru.begin(), lru, it->second);
+    ++it->second->hits;
+    return it->second->file;
+}
+
+void FileCache::insert(const std::string &key,
+                       const std::shared_ptr<const CachedFile> &file) {
+    size_t cost = cached_size(*file);
+    if (cost > max_bytes) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry entry;
+    entry.key = key;
+    entry.file = file;
+    entry.hits = 0;
+    auto it = index.find(key);
+    if (it != index.end()) {
+        entry.hits = it->second->hits; // A refreshed entry stays hot
+        current_bytes -= cached_size(*it->second->file);
+        lru.erase(it->second);
+        index.erase(it);
+    }
+    evict_to(max_bytes - cost);
+    lru.push_front(entry);
+    index[key] = lru.begin();
+    current_bytes += cost;
+}
+
+bool FileCache::erase(const std::string &key) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = index.find(key);
+    if (it == index.end()) {
+        return false;
+    }
+    current_bytes -= cached_size(*it->second->file);
+    lru.erase(it->second);
+    index.erase(it);
+    return true;
+}
+
+size_t FileCache::erase_prefix(const std::string &prefix) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t erased = 0;
+    for (auto it = lru.begin(); it != lru.end();) {
+        if (it->key.compare(0, prefix.size(), prefix) == 0) {
+            current_bytes -= cached_size(*it->file);
+            index.erase(it->key);
+            it = lru.erase(it);
+            ++erased;
+        } else {
+            ++it;
+        }
+    }
+    return erased;
+}
+
+void FileCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    lru.clear();
+    index.clear();
+    current_bytes = 0;
+}
+
+std::vector<std::pair<std::string, uint64_t>>
+FileCache::hot_set(size_t limit, bool decay) {
+    std::vector<std::pair<std::string, uint64_t>> hot;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        hot.reserve(index.size());
+        for (auto it = lru.begin(); it != lru.end(); ++it) {
+            hot.push_back(std::make_pair(it->key, it->hits));
+            if (decay) {
+                it->hits /= 2;
+            }
+        }
+    }
+    // Equal counts keep recency order
+    typedef std::pair<std::string, uint64_t> Hot;
+    std::stable_sort(hot.begin(), hot.end(), [](const Hot &a, const Hot &b) {
+        return a.second > b.second;
+    });
+    if (hot.size() > limit) {
+        hot.resize(limit);
+    }
+    return hot;
+}
+
+size_t FileCache::size_bytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return current_bytes;
+}
+
+size_t FileCache::entry_count() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return index.size();
+}
+
+void FileCache::evict_to(size_t limit) {
+    while (current_bytes > limit && !lru.empty()) {
+        current_bytes -= cached_size(*lru.back().file);
+        index.erase(lru.back().key);
+        lru.pop_back();
+    }
+}
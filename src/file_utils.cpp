@@ -1,8 +1,17 @@
 #include "../include/file_utils.h"
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
 #include <fstream>
 #include <sstream>
 #include <stdexcept>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifdef SYS_openat2
+#include <linux/openat2.h>
+#endif
 
 namespace file_utils {
 bool file_exists(const std::string &path) {
@@ -28,4 +37,165 @@ std::string get_file_extension(const std::string &path) {
     }
     return "";
 }
-} // namespace file_utils
\ No newline at end of file
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+// Resolves the segment [seg, w) that was just written. "." is dropped and
+// ".." removes the previous segment; both leave w just after a '/'.
+static bool close_segment(std::string &path, size_t seg, size_t &w) {
+    size_t len = w - seg;
+    if (len == 1 && path[seg] == '.') {
+        w = seg;
+    } else if (len == 2 && path[seg] == '.' && path[seg + 1] == '.') {
+        if (seg <= 1) {
+            return false; // Would escape the root
+        }
+        w = seg - 1;
+        while (w > 0 && path[w - 1] != '/') {
+            --w;
+        }
+    }
+    return true;
+}
+
+bool normalize_path(std::string &path) {
+    if (path.empty() || path[0] != '/') {
+        return false;
+    }
+
+    // Decoding only ever shrinks the string, so the write cursor never
+    // overtakes the read cursor and the rewrite can happen in place.
+    const size_t n = path.size();
+    size_t w = 0;
+    size_t seg = 0;
+    for (size_t r = 0; r < n; ++r) {
+        char c = path[r];
+        if (c == '%') {
+            if (r + 2 >= n) {
+                return false;
+            }
+            int hi = hex_value(path[r + 1]);
+            int lo = hex_value(path[r + 2]);
+            if (hi < 0 || lo < 0) {
+                return false;
+            }
+            c = static_cast<char>((hi << 4) | lo);
+            r += 2;
+        }
+        if (c == '\0') {
+            return false;
+        }
+
+        if (c == '/') {
+            if (!close_segment(path, seg, w)) {
+                return false;
+            }
+            if (w == 0 || path[w - 1] != '/') {
+                path[w++] = '/';
+            }
+            seg = w;
+        } else {
+            path[w++] = c;
+        }
+    }
+    if (!close_segment(path, seg, w)) {
+        return false;
+    }
+
+    path.resize(w);
+    return true;
+}
+
+bool request_key(const std::string &target, std::string &key) {
+    key = target;
+    if (!normalize_path(key)) {
+        return false;
+    }
+    if (key[key.size() - 1] == '/') {
+        key += "index.html";
+    }
+    return true;
+}
+
+#ifdef SYS_openat2
+namespace {
+// Set once openat2 is known to be missing (ENOSYS) or filtered by a
+// seccomp policy (EPERM), so later opens skip the probe
+std::atomic<bool> openat2_unavailable(false);
+} // namespace
+#endif
+
+int open_beneath(int dir_fd, const char *relative_path) {
+#ifdef SYS_openat2
+    if (!openat2_unavailable.load(std::memory_order_relaxed)) {
+        struct open_how how = {};
+        how.flags = O_RDONLY | O_CLOEXEC;
+        how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+        int fd = static_cast<int>(
+            syscall(SYS_openat2, dir_fd, relative_path, &how, sizeof(how)));
+        if (fd >= 0 || (errno != ENOSYS && errno != EPERM)) {
+            return fd;
+        }
+        openat2_unavailable.store(true, std::memory_order_relaxed);
+    }
+#endif
+    // Older kernels and sandboxes: the path is already normalized, so only symlinks could
+    // still lead outside the root.
+    return openat(dir_fd, relative_path, O_RDONLY | O_CLOEXEC);
+}
+
+std::string read_fd(int fd, size_t size_hint) {
+    // With a size hint (from fstat) the buffer is allocated exactly once and
+    // reading stops at that size; otherwise grow until EOF.
+    std::string content(size_hint, '\0');
+    size_t total = 0;
+    while (true) {
+        if (total == content.size()) {
+            if (size_hint > 0) {
+                break;
+            }
+            content.resize(content.empty() ? 4096 : content.size() * 2);
+        }
+        ssize_t n = pread(fd, &content[total], content.size() - total,
+                          static_cast<off_t>(total));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Cannot read file descriptor");
+        }
+        if (n == 0) {
+            break;
+        }
+        total += static_cast<size_t>(n);
+    }
+    content.resize(total);
+    return content;
+}
+
+bool prefetch_fd(int fd, size_t size) {
+    if (size == 0) {
+        return true;
+    }
+    // readahead() queues the reads and returns; filesystems that do not
+    // support it still fault the pages in through a populated mapping.
+    if (readahead(fd, 0, size) == 0) {
+        return true;
+    }
+    void *mapping =
+        mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    munmap(mapping, size);
+    return true;
+}
+} // namespace file_utils
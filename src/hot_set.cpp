@@ -0,0 +1,59 @@
+#include "../include/hot_set.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+
+namespace hot_set {
+namespace {
+const char HEADER[] = "# static_server hot set v1";
+}
+
+bool save(const std::string &path, const std::vector<Entry> &entries) {
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary.c_str(), std::ios::trunc);
+        out << HEADER << '\n';
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const Entry &entry = entries[i];
+            // One tab-separated line per entry; keys that would break the
+            // format are simply not recorded
+            if (entry.key.find_first_of("\t\n") != std::string::npos ||
+                entry.host.find_first_of("\t\n") != std::string::npos) {
+                continue;
+            }
+            out << entry.hits << '\t' << entry.host << '\t' << entry.key
+                << '\n';
+        }
+        out.flush();
+        if (!out) {
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+std::vector<Entry> load(const std::string &path) {
+    std::vector<Entry> entries;
+    std::ifstream in(path.c_str());
+    std::string line;
+    if (!std::getline(in, line) || line != HEADER) {
+        return entries;
+    }
+    while (std::getline(in, line)) {
+        size_t host_start = line.find('\t');
+        size_t key_start = host_start == std::string::npos
+                               ? std::string::npos
+                               : line.find('\t', host_start + 1);
+        if (key_start == std::string::npos || key_start + 1 >= line.size()) {
+            continue;
+        }
+        Entry entry;
+        entry.hits = strtoull(line.c_str(), nullptr, 10);
+        entry.host = line.substr(host_start + 1, key_start - host_start - 1);
+        entry.key = line.substr(key_start + 1);
+        entries.push_back(entry);
+    }
+    return entries;
+}
+} // namespace hot_set
@@ -0,0 +1,426 @@
+#include "../include/hpack.h"
+
+namespace hpack {
+namespace {
+struct StaticEntry {
+    const char *name;
+    const char *value;
+};
+
+// RFC 7541 Appendix A; index 1 is the first element
+const StaticEntry STATIC_TABLE[] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""}};
+const size_t STATIC_TABLE_SIZE =
+    sizeof(STATIC_TABLE) / sizeof(STATIC_TABLE[0]);
+
+const size_t ENTRY_OVERHEAD = 32;
+
+struct HuffmanCode {
+    uint32_t code;
+    uint8_t length;
+};
+
+// RFC 7541 Appendix B, symbols 0-255 (EOS is only valid as padding)
+const HuffmanCode HUFFMAN_CODES[256] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+    {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+    {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+    {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+    {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+    {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},
+    {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+    {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},
+    {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},
+    {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+    {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+    {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},
+    {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},
+    {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+    {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+    {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},
+    {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},
+    {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+    {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+    {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},
+    {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+    {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+    {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+    {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+    {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},
+    {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},
+    {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+    {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+    {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},
+    {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+    {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+    {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+    {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+    {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+    {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},
+    {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+    {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+    {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+    {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+    {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},
+    {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+    {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+    {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+};
+
+// Binary decoding tree built once from HUFFMAN_CODES. Child values > 0
+// are node indices, < 0 encode a symbol as -(symbol + 1), 0 means none.
+struct HuffmanTree {
+    struct Node {
+        int16_t child[2];
+    };
+    std::vector<Node> nodes;
+
+    HuffmanTree() {
+        Node root = {{0, 0}};
+        nodes.push_back(root);
+        for (int sym = 0; sym < 256; ++sym) {
+            const HuffmanCode &hc = HUFFMAN_CODES[sym];
+            size_t node = 0;
+            for (int bit = hc.length - 1; bit >= 0; --bit) {
+                int b = (hc.code >> bit) & 1;
+                if (bit == 0) {
+                    nodes[node].child[b] = static_cast<int16_t>(-(sym + 1));
+                } else {
+                    if (nodes[node].child[b] == 0) {
+                        nodes[node].child[b] =
+                            static_cast<int16_t>(nodes.size());
+                        nodes.push_back(root);
+                    }
+                    node = static_cast<size_t>(nodes[node].child[b]);
+                }
+            }
+        }
+    }
+};
+
+const HuffmanTree &huffman_tree() {
+    static const HuffmanTree tree;
+    return tree;
+}
+
+bool decode_integer(const uint8_t *&p, const uint8_t *end, int prefix_bits,
+                    uint64_t &value) {
+    if (p >= end) {
+        return false;
+    }
+    const uint8_t max_prefix = static_cast<uint8_t>((1 << prefix_bits) - 1);
+    value = *p++ & max_prefix;
+    if (value < max_prefix) {
+        return true;
+    }
+    int shift = 0;
+    while (p < end) {
+        uint8_t b = *p++;
+        value += static_cast<uint64_t>(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) {
+            return true;
+        }
+        shift += 7;
+        if (shift > 28) {
+            return false; // Far beyond any sane length or index
+        }
+    }
+    return false;
+}
+
+bool decode_string(const uint8_t *&p, const uint8_t *end, std::string &out) {
+    if (p >= end) {
+        return false;
+    }
+    bool huffman = (*p & 0x80) != 0;
+    uint64_t length;
+    if (!decode_integer(p, end, 7, length) ||
+        length > static_cast<uint64_t>(end - p)) {
+        return false;
+    }
+    out.clear();
+    bool ok = true;
+    if (huffman) {
+        ok = huffman_decode(p, static_cast<size_t>(length), out);
+    } else {
+        out.assign(reinterpret_cast<const char *>(p),
+                   static_cast<size_t>(length));
+    }
+    p += length;
+    return ok;
+}
+
+int static_index(const std::string &name, const std::string &value,
+                 bool &exact) {
+    int name_match = 0;
+    exact = false;
+    for (size_t i = 0; i < STATIC_TABLE_SIZE; ++i) {
+        if (name != STATIC_TABLE[i].name) {
+            continue;
+        }
+        if (value == STATIC_TABLE[i].value) {
+            exact = true;
+            return static_cast<int>(i + 1);
+        }
+        if (name_match == 0) {
+            name_match = static_cast<int>(i + 1);
+        }
+    }
+    return name_match;
+}
+} // namespace
+
+bool huffman_decode(const uint8_t *data, size_t len, std::string &out) {
+    const HuffmanTree &tree = huffman_tree();
+    size_t node = 0;
+    int pending_bits = 0; // Bits consumed since the last symbol
+    bool all_ones = true;
+    for (size_t i = 0; i < len; ++i) {
+        for (int bit = 7; bit >= 0; --bit) {
+            int b = (data[i] >> bit) & 1;
+            int16_t next = tree.nodes[node].child[b];
+            if (next == 0) {
+                return false; // EOS or an invalid code
+            }
+            if (next < 0) {
+                out += static_cast<char>(-next - 1);
+                node = 0;
+                pending_bits = 0;
+                all_ones = true;
+            } else {
+                node = static_cast<size_t>(next);
+                ++pending_bits;
+                all_ones = all_ones && b == 1;
+            }
+        }
+    }
+    // Padding must be a strict prefix of EOS: at most 7 one bits
+    return pending_bits <= 7 && all_ones;
+}
+
+Decoder::Decoder(size_t max_table_size, size_t max_list_size)
+    : table_size(0), max_table_size(max_table_size),
+      settings_table_size(max_table_size), max_list_size(max_list_size) {}
+
+bool Decoder::lookup(uint64_t index, Header &header) const {
+    if (index == 0) {
+        return false;
+    }
+    if (index <= STATIC_TABLE_SIZE) {
+        header.first = STATIC_TABLE[index - 1].name;
+        header.second = STATIC_TABLE[index - 1].value;
+        return true;
+    }
+    index -= STATIC_TABLE_SIZE + 1;
+    if (index >= dynamic_table.size()) {
+        return false;
+    }
+    header = dynamic_table[static_cast<size_t>(index)];
+    return true;
+}
+
+void Decoder::evict(size_t limit) {
+    while (table_size > limit && !dynamic_table.empty()) {
+        const Header &oldest = dynamic_table.back();
+        table_size -= oldest.first.size() + oldest.second.size() +
+                      ENTRY_OVERHEAD;
+        dynamic_table.pop_back();
+    }
+}
+
+void Decoder::insert(const Header &header) {
+    size_t entry_size =
+        header.first.size() + header.second.size() + ENTRY_OVERHEAD;
+    if (entry_size > max_table_size) {
+        evict(0); // An oversized entry empties the table
+        return;
+    }
+    evict(max_table_size - entry_size);
+    dynamic_table.push_front(header);
+    table_size += entry_size;
+}
+
+bool Decoder::decode(const uint8_t *data, size_t len, HeaderList &headers) {
+    const uint8_t *p = data;
+    const uint8_t *end = data + len;
+    bool seen_field = false;
+    size_t list_size = 0;
+
+    while (p < end) {
+        uint8_t b = *p;
+        uint64_t index;
+        Header header;
+
+        if (b & 0x80) {
+            // Indexed header field
+            if (!decode_integer(p, end, 7, index) || !lookup(index, header)) {
+                return false;
+            }
+        } else if ((b & 0xe0) == 0x20) {
+            // Dynamic table size update, only before the first field
+            if (seen_field || !decode_integer(p, end, 5, index) ||
+                index > settings_table_size) {
+                return false;
+            }
+            max_table_size = static_cast<size_t>(index);
+            evict(max_table_size);
+            continue;
+        } else {
+            // Literal: with incremental indexing (01), without (0000) or
+            // never indexed (0001)
+            bool incremental = (b & 0xc0) == 0x40;
+            int prefix = incremental ? 6 : 4;
+            if (!decode_integer(p, end, prefix, index)) {
+                return false;
+            }
+            if (index == 0) {
+                if (!decode_string(p, end, header.first)) {
+                    return false;
+                }
+            } else {
+                Header named;
+                if (!lookup(index, named)) {
+                    return false;
+                }
+                header.first = named.first;
+            }
+            if (!decode_string(p, end, header.second)) {
+                return false;
+            }
+            if (incremental) {
+                insert(header);
+            }
+        }
+        // Indexed references are one byte each, so the compressed limit
+        // alone would let a block expand to hundreds of megabytes
+        list_size += header.first.size() + header.second.size() +
+                     ENTRY_OVERHEAD;
+        if (list_size > max_list_size) {
+            return false;
+        }
+        seen_field = true;
+        headers.push_back(header);
+    }
+    return true;
+}
+
+void encode_integer(std::string &out, uint64_t value, int prefix_bits,
+                    uint8_t first_byte) {
+    const uint64_t max_prefix = (1u << prefix_bits) - 1;
+    if (value < max_prefix) {
+        out += static_cast<char>(first_byte | value);
+        return;
+    }
+    out += static_cast<char>(first_byte | max_prefix);
+    value -= max_prefix;
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+void encode_string(std::string &out, const std::string &value) {
+    encode_integer(out, value.size(), 7, 0x00);
+    out += value;
+}
+
+void encode_header(std::string &out, const std::string &name,
+                   const std::string &value) {
+    bool exact;
+    int index = static_index(name, value, exact);
+    if (exact) {
+        encode_integer(out, static_cast<uint64_t>(index), 7, 0x80);
+        return;
+    }
+    // Literal header field without indexing
+    if (index > 0) {
+        encode_integer(out, static_cast<uint64_t>(index), 4, 0x00);
+    } else {
+        out += '\0';
+        encode_string(out, name);
+    }
+    encode_string(out, value);
+}
+} // namespace hpack
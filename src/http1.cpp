@@ -0,0 +1,153 @@
+#include "../include/http1.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <strings.h>
+
+namespace http1 {
+namespace {
+// The C locale's whitespace, which splits request line words
+bool is_space(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+size_t skip_space(const std::string &text, size_t pos, size_t end) {
+    while (pos < end && is_space(text[pos])) {
+        ++pos;
+    }
+    return pos;
+}
+
+size_t skip_word(const std::string &text, size_t pos, size_t end) {
+    while (pos < end && !is_space(text[pos])) {
+        ++pos;
+    }
+    return pos;
+}
+
+// Steps to the next header line. On entry line is the CRLF ending the
+// previous line; on return [begin, line) is the next one without its CRLF.
+// Only CRLF ends a line, and an unterminated tail is not a line.
+bool next_line(const std::string &head, size_t &begin, size_t &line) {
+    if (line == std::string::npos || line + 2 >= head.size()) {
+        return false;
+    }
+    begin = line + 2;
+    line = head.find("\r\n", begin);
+    return line != std::string::npos;
+}
+} // namespace
+
+std::string find_header(const std::string &head, const char *name) {
+    size_t name_length = strlen(name);
+    size_t begin = 0;
+    size_t line = head.find("\r\n");
+    while (next_line(head, begin, line)) {
+        if (line - begin <= name_length ||
+            head[begin + name_length] != ':' ||
+            strncasecmp(head.c_str() + begin, name, name_length) != 0) {
+            continue;
+        }
+        size_t value = head.find_first_not_of(" \t", begin + name_length + 1);
+        if (value == std::string::npos || value >= line) {
+            return ""; // Blanks only
+        }
+        size_t value_end = head.find_last_not_of(" \t", line - 1);
+        return head.substr(value, value_end + 1 - value);
+    }
+    return "";
+}
+
+void parse_request_line(const std::string &head, std::string &method,
+                        std::string &path) {
+    // Scanned in place; this runs for every request
+    size_t end = std::min(head.find('\r'), head.size());
+    size_t begin = skip_space(head, 0, end);
+    size_t stop = skip_word(head, begin, end);
+    method.assign(head, begin, stop - begin);
+
+    begin = skip_space(head, stop, end);
+    stop = skip_word(head, begin, end);
+    path.assign(head, begin, std::min(head.find('?', begin), stop) - begin);
+}
+
+HttpRequest parse_request(const std::string &head) {
+    HttpRequest request;
+    parse_request_line(head, request.method, request.path);
+    request.host = find_header(head, "host");
+    request.accept_encoding = find_header(head, "accept-encoding");
+    request.if_none_match = find_header(head, "if-none-match");
+    return request;
+}
+
+bool keep_alive(const std::string &head) {
+    size_t line_end = head.find("\r\n");
+    if (line_end == std::string::npos) {
+        return false;
+    }
+    size_t version = head.rfind(' ', line_end);
+    if (version == std::string::npos ||
+        head.compare(version + 1, line_end - version - 1, "HTTP/1.1") != 0) {
+        return false;
+    }
+    std::string connection = find_header(head, "connection");
+    for (size_t i = 0; i < connection.size(); ++i) {
+        connection[i] = static_cast<char>(
+            tolower(static_cast<unsigned char>(connection[i])));
+    }
+    return connection.find("close") == std::string::npos;
+}
+
+bool body_length(const std::string &head, size_t &length) {
+    length = 0;
+    bool seen = false;
+
+    // A peer that ends lines at a bare LF would see headers hidden here
+    for (size_t i = head.find('\n'); i != std::string::npos;
+         i = head.find('\n', i + 1)) {
+        if (i == 0 || head[i - 1] != '\r') {
+            return false;
+        }
+    }
+
+    size_t begin = 0;
+    size_t line_end = head.find("\r\n");
+    while (next_line(head, begin, line_end)) {
+        size_t colon = static_cast<size_t>(
+            std::find(head.begin() + begin, head.begin() + line_end, ':') -
+            head.begin());
+        if (colon < line_end) {
+            size_t name_end = colon;
+            while (name_end > begin && (head[name_end - 1] == ' ' ||
+                                        head[name_end - 1] == '\t')) {
+                --name_end;
+            }
+            std::string name = head.substr(begin, name_end - begin);
+            if (strcasecmp(name.c_str(), "transfer-encoding") == 0) {
+                return false;
+            }
+            if (strcasecmp(name.c_str(), "content-length") == 0) {
+                size_t value = head.find_first_not_of(" \t", colon + 1);
+                size_t value_end = head.find_last_not_of(" \t", line_end - 1);
+                if (name_end != colon || value >= line_end ||
+                    value_end - value >= 18) {
+                    return false;
+                }
+                size_t number = 0;
+                for (size_t i = value; i <= value_end; ++i) {
+                    if (head[i] < '0' || head[i] > '9') {
+                        return false;
+                    }
+                    number = number * 10 + static_cast<size_t>(head[i] - '0');
+                }
+                if (seen && number != length) {
+                    return false;
+                }
+                seen = true;
+                length = number;
+            }
+        }
+    }
+    return true;
+}
+} // namespace http1
@@ -0,0 +1,547 @@
+#include "../include/http2.h"
+#include <algorithm>
+
+namespace http2 {
+const char CONNECTION_PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+namespace {
+enum FrameType {
+    FRAME_DATA = 0x0,
+    FRAME_HEADERS = 0x1,
+    FRAME_PRIORITY = 0x2,
+    FRAME_RST_STREAM = 0x3,
+    FRAME_SETTINGS = 0x4,
+    FRAME_PUSH_PROMISE = 0x5,
+    FRAME_PING = 0x6,
+    FRAME_GOAWAY = 0x7,
+    FRAME_WINDOW_UPDATE = 0x8,
+    FRAME_CONTINUATION = 0x9
+};
+
+enum FrameFlags {
+    FLAG_END_STREAM = 0x1,
+    FLAG_ACK = 0x1,
+    FLAG_END_HEADERS = 0x4,
+    FLAG_PADDED = 0x8,
+    FLAG_PRIORITY = 0x20
+};
+
+enum ErrorCode {
+    NO_ERROR = 0x0,
+    PROTOCOL_ERROR = 0x1,
+    FLOW_CONTROL_ERROR = 0x3,
+    FRAME_SIZE_ERROR = 0x6,
+    REFUSED_STREAM = 0x7,
+    COMPRESSION_ERROR = 0x9,
+    ENHANCE_YOUR_CALM = 0xb
+};
+
+enum SettingId {
+    SETTINGS_HEADER_TABLE_SIZE = 0x1,
+    SETTINGS_ENABLE_PUSH = 0x2,
+    SETTINGS_MAX_CONCURRENT_STREAMS = 0x3,
+    SETTINGS_INITIAL_WINDOW_SIZE = 0x4,
+    SETTINGS_MAX_FRAME_SIZE = 0x5,
+    SETTINGS_MAX_HEADER_LIST_SIZE = 0x6
+};
+
+const size_t FRAME_HEADER_LENGTH = 9;
+const uint32_t DEFAULT_MAX_FRAME_SIZE = 16384;
+const int64_t DEFAULT_WINDOW_SIZE = 65535;
+const int64_t MAX_WINDOW_SIZE = 0x7fffffff;
+const uint32_t MAX_CONCURRENT_STREAMS = 100;
+const size_t MAX_HEADER_BLOCK = 64 * 1024;
+// Acks and WINDOW_UPDATEs owed to a peer that is not reading
+const size_t MAX_CONTROL_BYTES = 64 * 1024;
+
+uint32_t read_u32(const uint8_t *p) {
+    return (static_cast<uint32_t>(p[0]) << 24) |
+           (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+void append_u32(std::string &out, uint32_t value) {
+    out += static_cast<char>(value >> 24);
+    out += static_cast<char>(value >> 16);
+    out += static_cast<char>(value >> 8);
+    out += static_cast<char>(value);
+}
+
+void append_frame_header(std::string &out, uint32_t length, uint8_t type,
+                         uint8_t flags, uint32_t stream_id) {
+    out += static_cast<char>(length >> 16);
+    out += static_cast<char>(length >> 8);
+    out += static_cast<char>(length);
+    out += static_cast<char>(type);
+    out += static_cast<char>(flags);
+    append_u32(out, stream_id & 0x7fffffff);
+}
+
+void append_window_update(std::string &out, uint32_t stream_id,
+                          uint32_t increment) {
+    append_frame_header(out, 4, FRAME_WINDOW_UPDATE, 0, stream_id);
+    append_u32(out, increment);
+}
+
+// HTTP2-Settings carries base64url without padding (RFC 7540 3.2.1)
+bool base64url_decode(const std::string &in, std::string &out) {
+    uint32_t buffer = 0;
+    int bits = 0;
+    for (size_t i = 0; i < in.size(); ++i) {
+        char c = in[i];
+        int value;
+        if (c >= 'A' && c <= 'Z')
+            value = c - 'A';
+        else if (c >= 'a' && c <= 'z')
+            value = c - 'a' + 26;
+        else if (c >= '0' && c <= '9')
+            value = c - '0' + 52;
+        else if (c == '-' || c == '+')
+            value = 62;
+        else if (c == '_' || c == '/')
+            value = 63;
+        else if (c == '=')
+            break;
+        else
+            return false;
+        buffer = (buffer << 6) | static_cast<uint32_t>(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out += static_cast<char>((buffer >> bits) & 0xff);
+        }
+    }
+    return true;
+}
+} // namespace
+
+Session::Session(const RequestHandler &handler)
+    : handler(handler), preface_received(false), goaway_sent(false),
+      goaway_received(false), last_stream_id(0), continuation_stream(0),
+      continuation_end_stream(false), connection_window(DEFAULT_WINDOW_SIZE),
+      peer_initial_window(DEFAULT_WINDOW_SIZE),
+      peer_max_frame_size(DEFAULT_MAX_FRAME_SIZE) {
+    // Server connection preface
+    append_frame_header(control, 12, FRAME_SETTINGS, 0, 0);
+    control += static_cast<char>(0);
+    control += static_cast<char>(SETTINGS_MAX_CONCURRENT_STREAMS);
+    append_u32(control, MAX_CONCURRENT_STREAMS);
+    control += static_cast<char>(0);
+    control += static_cast<char>(SETTINGS_MAX_HEADER_LIST_SIZE);
+    append_u32(control,
+               static_cast<uint32_t>(hpack::DEFAULT_MAX_HEADER_LIST_SIZE));
+}
+
+bool Session::upgrade(const std::string &settings_header,
+                      const HttpRequest &request) {
+    std::string settings;
+    if (!base64url_decode(settings_header, settings) ||
+        settings.size() % 6 != 0) {
+        return false;
+    }
+    // Acknowledged by the 101 response itself, not by a SETTINGS ACK
+    if (!apply_settings(reinterpret_cast<const uint8_t *>(settings.data()),
+                        settings.size())) {
+        return false;
+    }
+    last_stream_id = 1;
+    open_stream(1, request);
+    return true;
+}
+
+bool Session::receive(const char *data, size_t len) {
+    if (goaway_sent) {
+        return false;
+    }
+    input.append(data, len);
+
+    size_t pos = 0;
+    if (!preface_received) {
+        size_t n = std::min(input.size(), CONNECTION_PREFACE_LENGTH);
+        if (input.compare(0, n, CONNECTION_PREFACE, n) != 0) {
+            return connection_error(PROTOCOL_ERROR);
+        }
+        if (n < CONNECTION_PREFACE_LENGTH) {
+            return true;
+        }
+        preface_received = true;
+        pos = CONNECTION_PREFACE_LENGTH;
+    }
+
+    while (input.size() - pos >= FRAME_HEADER_LENGTH) {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(input.data()) + pos;
+        uint32_t length = (static_cast<uint32_t>(p[0]) << 16) |
+                          (static_cast<uint32_t>(p[1]) << 8) | p[2];
+        if (length > DEFAULT_MAX_FRAME_SIZE) {
+            return connection_error(FRAME_SIZE_ERROR);
+        }
+        if (input.size() - pos < FRAME_HEADER_LENGTH + length) {
+            break;
+        }
+        uint32_t stream_id = read_u32(p + 5) & 0x7fffffff;
+        if (!handle_frame(p[3], p[4], stream_id, p + FRAME_HEADER_LENGTH,
+                          length)) {
+            return false;
+        }
+        if (control.size() > MAX_CONTROL_BYTES) {
+            return connection_error(ENHANCE_YOUR_CALM);
+        }
+        pos += FRAME_HEADER_LENGTH + length;
+    }
+    input.erase(0, pos);
+    return true;
+}
+
+bool Session::handle_frame(uint8_t type, uint8_t flags, uint32_t stream_id,
+                           const uint8_t *payload, uint32_t length) {
+    if (continuation_stream != 0 &&
+        (type != FRAME_CONTINUATION || stream_id != continuation_stream)) {
+        return connection_error(PROTOCOL_ERROR);
+    }
+
+    switch (type) {
+    case FRAME_DATA:
+        if (stream_id == 0) {
+            return connection_error(PROTOCOL_ERROR);
+        }
+        // Request bodies are discarded; hand the credit straight back
+        if (length > 0) {
+            append_window_update(control, 0, length);
+            if (streams.count(stream_id)) {
+                append_window_update(control, stream_id, length);
+            }
+        }
+        return true;
+
+    case FRAME_HEADERS:
+        return handle_headers(flags, stream_id, payload, length);
+
+    case FRAME_PRIORITY:
+        if (stream_id == 0) {
+            return connection_error(PROTOCOL_ERROR);
+        }
+        if (length != 5) {
+            reset_stream(stream_id, FRAME_SIZE_ERROR);
+        }
+        return true; // Prioritization is not implemented
+
+    case FRAME_RST_STREAM:
+        if (stream_id == 0) {
+            return connection_error(PROTOCOL_ERROR);
+        }
+        if (length != 4) {
+            return connection_error(FRAME_SIZE_ERROR);
+        }
+        streams.erase(stream_id);
+        return true;
+
+    case FRAME_SETTINGS:
+        if (stream_id != 0) {
+            return connection_error(PROTOCOL_ERROR);
+        }
+        if (flags & FLAG_ACK) {
+            return length == 0 || connection_error(FRAME_SIZE_ERROR);
+        }
+        if (length % 6 != 0) {
+            return connection_error(FRAME_SIZE_ERROR);
+        }
+        if (!apply_settings(payload, length)) {
+            return false;
+        }
+        append_frame_header(control, 0, FRAME_SETTINGS, FLAG_ACK, 0);
+        return true;
+
+    case FRAME_PUSH_PROMISE:
+        return connection_error(PROTOCOL_ERROR);
+
+    case FRAME_PING:
+        if (stream_id != 0) {
+            return connection_error(PROTOCOL_ERROR);
+        }
+        if (length != 8) {
+            return connection_error(FRAME_SIZE_ERROR);
+        }
+        if (!(flags & FLAG_ACK)) {
+            append_frame_header(control, 8, FRAME_PING, FLAG_ACK, 0);
+            control.append(reinterpret_cast<const char *>(payload), 8);
+        }
+        return true;
+
+    case FRAME_GOAWAY:
+        if (stream_id != 0) {
+            return connection_error(PROTOCOL_ERROR);
+        }
+        goaway_received = true;
+        return true;
+
+    case FRAME_WINDOW_UPDATE: {
+        if (length != 4) {
+            return connection_error(FRAME_SIZE_ERROR);
+        }
+        uint32_t increment = read_u32(payload) & 0x7fffffff;
+        if (stream_id == 0) {
+            if (increment == 0) {
+                return connection_error(PROTOCOL_ERROR);
+            }
+            connection_window += increment;
+            if (connection_window > MAX_WINDOW_SIZE) {
+                return connection_error(FLOW_CONTROL_ERROR);
+            }
+            return true;
+        }
+        auto it = streams.find(stream_id);
+        if (increment == 0) {
+            reset_stream(stream_id, PROTOCOL_ERROR);
+        } else if (it != streams.end()) {
+            it->second.send_window += increment;
+            if (it->second.send_window > MAX_WINDOW_SIZE) {
+                reset_stream(stream_id, FLOW_CONTROL_ERROR);
+            }
+        }
+        return true;
+    }
+
+    case FRAME_CONTINUATION:
+        if (continuation_stream == 0) {
+            return connection_error(PROTOCOL_ERROR);
+        }
+        header_block.append(reinterpret_cast<const char *>(payload), length);
+        if (header_block.size() > MAX_HEADER_BLOCK) {
+            return connection_error(ENHANCE_YOUR_CALM);
+        }
+        if (flags & FLAG_END_HEADERS) {
+            uint32_t id = continuation_stream;
+            continuation_stream = 0;
+            return complete_headers(id);
+        }
+        return true;
+
+    default:
+        return true; // Unknown frame types must be ignored
+    }
+}
+
+bool Session::handle_headers(uint8_t flags, uint32_t stream_id,
+                             const uint8_t *payload, uint32_t length) {
+    if (stream_id == 0 || (stream_id & 1) == 0) {
+        return connection_error(PROTOCOL_ERROR);
+    }
+
+    // Strip padding and the priority block
+    size_t begin = 0;
+    size_t end = length;
+    if (flags & FLAG_PADDED) {
+        if (length < 1 || payload[0] >= length) {
+            return connection_error(PROTOCOL_ERROR);
+        }
+        end -= payload[0];
+        begin = 1;
+    }
+    if (flags & FLAG_PRIORITY) {
+        begin += 5;
+    }
+    if (begin > end) {
+        return connection_error(PROTOCOL_ERROR);
+    }
+
+    header_block.assign(reinterpret_cast<const char *>(payload) + begin,
+                        end - begin);
+    continuation_end_stream = (flags & FLAG_END_STREAM) != 0;
+    if (!(flags & FLAG_END_HEADERS)) {
+        continuation_stream = stream_id;
+        return true;
+    }
+    return complete_headers(stream_id);
+}
+
+bool Session::complete_headers(uint32_t stream_id) {
+    // Decode even blocks we reject so the HPACK state stays in sync
+    hpack::HeaderList headers;
+    bool decoded = decoder.decode(
+        reinterpret_cast<const uint8_t *>(header_block.data()),
+        header_block.size(), headers);
+    header_block.clear();
+    if (!decoded) {
+        return connection_error(COMPRESSION_ERROR);
+    }
+
+    if (stream_id <= last_stream_id) {
+        // Trailers on a stream we are still answering are ignored
+        return streams.count(stream_id) != 0 ||
+               connection_error(PROTOCOL_ERROR);
+    }
+    last_stream_id = stream_id;
+    if (goaway_received) {
+        return true;
+    }
+    if (streams.size() >= MAX_CONCURRENT_STREAMS) {
+        reset_stream(stream_id, REFUSED_STREAM);
+        return true;
+    }
+
+    HttpRequest request;
+    for (size_t i = 0; i < headers.size(); ++i) {
+        const std::string &name = headers[i].first;
+        if (name == ":method") {
+            request.method = headers[i].second;
+        } else if (name == ":path") {
+            const std::string &target = headers[i].second;
+            request.path = target.substr(0, target.find('?'));
+        } else if (name == ":authority" ||
+                   (name == "host" && request.host.empty())) {
+            request.host = headers[i].second;
+        } else if (name == "accept-encoding") {
+            request.accept_encoding = headers[i].second;
+        } else if (name == "if-none-match") {
+            request.if_none_match = headers[i].second;
+        }
+    }
+    if (request.method.empty() || request.path.empty()) {
+        reset_stream(stream_id, PROTOCOL_ERROR);
+        return true;
+    }
+    open_stream(stream_id, request);
+    return true;
+}
+
+void Session::open_stream(uint32_t stream_id, const HttpRequest &request) {
+    Stream stream;
+    stream.response = handler(request);
+    stream.offset = 0;
+    stream.send_window = peer_initial_window;
+    stream.headers_sent = false;
+    streams[stream_id] = stream;
+}
+
+bool Session::apply_settings(const uint8_t *payload, size_t length) {
+    for (size_t i = 0; i + 6 <= length; i += 6) {
+        uint16_t id = static_cast<uint16_t>((payload[i] << 8) | payload[i + 1]);
+        uint32_t value = read_u32(payload + i + 2);
+        switch (id) {
+        case SETTINGS_ENABLE_PUSH:
+            if (value > 1) {
+                return connection_error(PROTOCOL_ERROR);
+            }
+            break;
+        case SETTINGS_INITIAL_WINDOW_SIZE: {
+            if (value > MAX_WINDOW_SIZE) {
+                return connection_error(FLOW_CONTROL_ERROR);
+            }
+            int64_t delta = static_cast<int64_t>(value) - peer_initial_window;
+            peer_initial_window = value;
+            for (auto it = streams.begin(); it != streams.end(); ++it) {
+                it->second.send_window += delta;
+            }
+            break;
+        }
+        case SETTINGS_MAX_FRAME_SIZE:
+            if (value < DEFAULT_MAX_FRAME_SIZE || value > 0xffffff) {
+                return connection_error(PROTOCOL_ERROR);
+            }
+            peer_max_frame_size = value;
+            break;
+        default:
+            // The encoder never indexes, so the peer's table size is moot
+            break;
+        }
+    }
+    return true;
+}
+
+void Session::produce(std::string &out, size_t max_bytes) {
+    size_t start = out.size();
+    out += control;
+    control.clear();
+
+    // Round-robin: each pass gives every stream at most one frame
+    bool progress = true;
+    while (progress && out.size() - start < max_bytes) {
+        progress = false;
+        for (auto it = streams.begin(); it != streams.end();) {
+            bool finished = false;
+            if (produce_stream(out, it->second, it->first, finished)) {
+                progress = true;
+            }
+            if (finished) {
+                it = streams.erase(it);
+            } else {
+                ++it;
+            }
+            if (out.size() - start >= max_bytes) {
+                break;
+            }
+        }
+    }
+}
+
+bool Session::produce_stream(std::string &out, Stream &stream, uint32_t id,
+                             bool &finished) {
+    const CachedFile &response = *stream.response;
+    if (!stream.headers_sent) {
+        bool empty = response.body.empty();
+        uint8_t flags = FLAG_END_HEADERS | (empty ? FLAG_END_STREAM : 0);
+        append_frame_header(out,
+                            static_cast<uint32_t>(response.hpack_header.size()),
+                            FRAME_HEADERS, flags, id);
+        out += response.hpack_header;
+        stream.headers_sent = true;
+        finished = empty;
+        return true;
+    }
+
+    size_t remaining = response.body.size() - stream.offset;
+    int64_t window = std::min(stream.send_window, connection_window);
+    size_t chunk = std::min<size_t>(remaining, peer_max_frame_size);
+    if (window <= 0) {
+        return false; // Blocked until WINDOW_UPDATE
+    }
+    chunk = std::min<size_t>(chunk, static_cast<size_t>(window));
+
+    bool last = chunk == remaining;
+    append_frame_header(out, static_cast<uint32_t>(chunk), FRAME_DATA,
+                        last ? FLAG_END_STREAM : 0, id);
+    out.append(response.body.data() + stream.offset, chunk);
+    stream.offset += chunk;
+    stream.send_window -= static_cast<int64_t>(chunk);
+    connection_window -= static_cast<int64_t>(chunk);
+    finished = last;
+    return true;
+}
+
+bool Session::has_output() const {
+    if (!control.empty()) {
+        return true;
+    }
+    for (auto it = streams.begin(); it != streams.end(); ++it) {
+        if (!it->second.headers_sent) {
+            return true;
+        }
+        if (connection_window > 0 && it->second.send_window > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Session::is_closed() const {
+    if (!control.empty()) {
+        return false;
+    }
+    return goaway_sent || (goaway_received && streams.empty());
+}
+
+bool Session::connection_error(uint32_t error_code) {
+    append_frame_header(control, 8, FRAME_GOAWAY, 0, 0);
+    append_u32(control, last_stream_id);
+    append_u32(control, error_code);
+    goaway_sent = true;
+    streams.clear();
+    return false;
+}
+
+void Session::reset_stream(uint32_t stream_id, uint32_t error_code) {
+    append_frame_header(control, 4, FRAME_RST_STREAM, 0, stream_id);
+    append_u32(control, error_code);
+    streams.erase(stream_id);
+}
+} // namespace http2
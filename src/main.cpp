@@ -1,23 +1,49 @@
 #include "../include/config.h"
+#include "../include/config_file.h"
 #include "../include/server.h"
+#include <cstring>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 int main(int argc, char *argv[]) {
     try {
         // Parse command line arguments to override defaults
         ServerConfig config;
 
-        if (argc > 1) {
-            config.port = std::stoi(argv[1]);
+        int arg = 1;
+        if (argc > 2 && (strcmp(argv[1], "-c") == 0 ||
+                         strcmp(argv[1], "--config") == 0)) {
+            config = load_config_file(argv[2]);
+            arg = 3;
         }
-        if (argc > 2) {
-            config.root_directory = argv[2];
+        if (argc > arg) {
+            size_t length = 0;
+            int port = std::stoi(argv[arg], &length);
+            if (argv[arg][length] != '\0' || port < 0 || port > 65535) {
+                throw std::runtime_error(std::string("Invalid port: ") +
+                                         argv[arg]);
+            }
+            if (!config.listeners.empty()) {
+                std::cerr << "Warning: port " << port
+                          << " is ignored; the config file lists listeners"
+                          << std::endl;
+            }
+            config.port = port;
+        }
+        if (argc > arg + 1) {
+            config.root_directory = argv[arg + 1];
         }
 
         std::cout << "Starting static file server on port " << config.port
                   << std::endl;
         std::cout << "Serving files from: " << config.root_directory
                   << std::endl;
+        for (size_t i = 0; i < config.virtual_hosts.size(); ++i) {
+            const VirtualHostConfig &host = config.virtual_hosts[i];
+            std::cout << "Virtual host " << host.server_names[0] << ": "
+                      << host.root_directory << std::endl;
+        }
 
         // Initialize and start the server
         StaticFileServer server(config);
@@ -28,4 +54,4 @@ int main(int argc, char *argv[]) {
         std::cerr << "Error: " << e.what() << std::endl;
         return 1;
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,260 @@
+#include "../include/rate_limiter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <netinet/in.h>
+
+namespace {
+const size_t SHARD_COUNT = 16; // Power of two
+const size_t PROBE_LIMIT = 16; // Slots searched from an entry's home slot
+const size_t MIN_SHARD_SLOTS = 64;
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+uint64_t load_u64(const uint8_t *p) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+// splitmix64 finalizer
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+} // namespace
+
+ClientAddress client_address_from(const struct sockaddr *addr) {
+    ClientAddress address;
+    memset(&address, 0, sizeof(address));
+    if (addr->sa_family == AF_INET) {
+        const struct sockaddr_in *in =
+            reinterpret_cast<const struct sockaddr_in *>(addr);
+        address.bytes[10] = 0xff;
+        address.bytes[11] = 0xff;
+        memcpy(address.bytes + 12, &in->sin_addr, 4);
+        address.is_ipv4 = true;
+    } else if (addr->sa_family == AF_INET6) {
+        const struct sockaddr_in6 *in6 =
+            reinterpret_cast<const struct sockaddr_in6 *>(addr);
+        memcpy(address.bytes, &in6->sin6_addr, 16);
+        address.is_ipv4 = IN6_IS_ADDR_V4MAPPED(&in6->sin6_addr);
+    } else {
+        address.is_local = true;
+    }
+    return address;
+}
+
+RateLimiter::RateLimiter(const RateLimitConfig &config)
+    : config(config), shard_mask(SHARD_COUNT - 1) {
+    size_t slots = MIN_SHARD_SLOTS;
+    while (slots * SHARD_COUNT < config.table_size) {
+        slots <<= 1;
+    }
+    slot_mask = slots - 1;
+
+    // Tables are only allocated when some limit is active
+    if (!enabled()) {
+        return;
+    }
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        std::unique_ptr<Shard> shard(new Shard());
+        Bucket empty;
+        memset(&empty, 0, sizeof(empty));
+        shard->buckets.assign(slots, empty);
+        shards.push_back(std::move(shard));
+    }
+}
+
+bool RateLimiter::enabled() const {
+    return config.requests_per_second > 0 || config.bytes_per_second > 0 ||
+           config.max_connections > 0;
+}
+
+bool RateLimiter::admit_connection(const ClientAddress &address,
+                                   Admission &admission) {
+    admission.address = false;
+    admission.prefix = false;
+    if (config.max_connections == 0) {
+        return true;
+    }
+    uint8_t prefix = address.is_ipv4 ? 120 : 64;
+    if (!apply(address, 128, CONNECT, 0, &admission.address)) {
+        return false;
+    }
+    if (!apply(address, prefix, CONNECT, 0, &admission.prefix)) {
+        if (admission.address) {
+            apply(address, 128, DISCONNECT, 0);
+            admission.address = false;
+        }
+        return false;
+    }
+    return true;
+}
+
+void RateLimiter::release_connection(const ClientAddress &address,
+                                     const Admission &admission) {
+    if (admission.address) {
+        apply(address, 128, DISCONNECT, 0);
+    }
+    if (admission.prefix) {
+        apply(address, address.is_ipv4 ? 120 : 64, DISCONNECT, 0);
+    }
+}
+
+bool RateLimiter::allow_request(const ClientAddress &address) {
+    if (config.requests_per_second <= 0) {
+        return true;
+    }
+    return apply(address, 128, REQUEST, 0) &&
+           apply(address, address.is_ipv4 ? 120 : 64, REQUEST, 0);
+}
+
+bool RateLimiter::charge_bytes(const ClientAddress &address, size_t bytes) {
+    if (config.bytes_per_second <= 0) {
+        return true;
+    }
+    bool own = apply(address, 128, BYTES, bytes);
+    bool prefix = apply(address, address.is_ipv4 ? 120 : 64, BYTES, bytes);
+    return own && prefix;
+}
+
+bool RateLimiter::apply(const ClientAddress &address, uint8_t prefix,
+                        Operation op, size_t amount, bool *counted) {
+    if (address.is_local) {
+        return true;
+    }
+
+    // Mask the address down to the prefix being tracked
+    uint8_t masked[16];
+    memcpy(masked, address.bytes, 16);
+    for (int bit = prefix; bit < 128; ++bit) {
+        masked[bit / 8] &= static_cast<uint8_t>(~(0x80 >> (bit % 8)));
+    }
+    Key key;
+    key.high = load_u64(masked);
+    key.low = load_u64(masked + 8);
+    key.prefix = prefix;
+
+    uint64_t hash = mix(key.high ^ mix(key.low ^ prefix));
+    Shard &shard = *shards[hash & shard_mask];
+    size_t home = static_cast<size_t>(hash >> 32) & slot_mask;
+    double multiplier = prefix == 128 ? 1.0 : config.prefix_multiplier;
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    int64_t now = now_ns();
+    Bucket *bucket =
+        find_or_insert(shard, key, home, now, op != DISCONNECT);
+    if (bucket == nullptr) {
+        return true; // Every slot holds open connections: fail open
+    }
+    refill(*bucket, now, multiplier);
+
+    switch (op) {
+    case CONNECT:
+        if (bucket->connections >= config.max_connections * multiplier) {
+            return false;
+        }
+        ++bucket->connections;
+        if (counted != nullptr) {
+            *counted = true;
+        }
+        return true;
+    case DISCONNECT:
+        if (bucket->connections > 0) {
+            --bucket->connections;
+        }
+        return true;
+    case REQUEST:
+        if (bucket->request_tokens < 1) {
+            return false;
+        }
+        bucket->request_tokens -= 1;
+        return true;
+    case BYTES:
+        // Debt is allowed, capped at one burst, so large files still go out
+        bucket->byte_tokens = std::max(
+            bucket->byte_tokens - static_cast<double>(amount),
+            -config.byte_burst * multiplier);
+        return bucket->byte_tokens >= 0;
+    }
+    return true;
+}
+
+RateLimiter::Bucket *RateLimiter::find_or_insert(Shard &shard, const Key &key,
+                                                 size_t home, int64_t now,
+                                                 bool insert) {
+    size_t free_slot = slot_mask + 1;
+    size_t stalest = slot_mask + 1; // Least recently used, no connections
+    for (size_t i = 0; i < PROBE_LIMIT; ++i) {
+        size_t slot = (home + i) & slot_mask;
+        Bucket &bucket = shard.buckets[slot];
+        if (bucket.used && bucket.key == key) {
+            return &bucket;
+        }
+        if (free_slot > slot_mask &&
+            (!bucket.used || is_idle(bucket, now))) {
+            free_slot = slot;
+        }
+        if (bucket.used && bucket.connections == 0 &&
+            (stalest > slot_mask ||
+             bucket.last_refill < shard.buckets[stalest].last_refill)) {
+            stalest = slot;
+        }
+    }
+    if (free_slot > slot_mask) {
+        free_slot = stalest;
+    }
+    if (!insert || free_slot > slot_mask) {
+        return nullptr;
+    }
+
+    double multiplier = key.prefix == 128 ? 1.0 : config.prefix_multiplier;
+    Bucket &bucket = shard.buckets[free_slot];
+    bucket.key = key;
+    bucket.used = true;
+    bucket.connections = 0;
+    bucket.request_tokens = config.request_burst * multiplier;
+    bucket.byte_tokens = config.byte_burst * multiplier;
+    bucket.last_refill = now;
+    return &bucket;
+}
+
+bool RateLimiter::is_idle(const Bucket &bucket, int64_t now) const {
+    // An entry whose buckets have refilled completely carries no state
+    if (bucket.connections > 0) {
+        return false;
+    }
+    double multiplier =
+        bucket.key.prefix == 128 ? 1.0 : config.prefix_multiplier;
+    Bucket copy = bucket;
+    refill(copy, now, multiplier);
+    return copy.request_tokens >= config.request_burst * multiplier &&
+           copy.byte_tokens >= config.byte_burst * multiplier;
+}
+
+void RateLimiter::refill(Bucket &bucket, int64_t now,
+                         double multiplier) const {
+    double elapsed = static_cast<double>(now - bucket.last_refill) / 1e9;
+    if (elapsed <= 0) {
+        return;
+    }
+    bucket.request_tokens =
+        std::min(config.request_burst * multiplier,
+                 bucket.request_tokens +
+                     config.requests_per_second * multiplier * elapsed);
+    bucket.byte_tokens = std::min(
+        config.byte_burst * multiplier,
+        bucket.byte_tokens + config.bytes_per_second * multiplier * elapsed);
+    bucket.last_refill = now;
+}
@@ -1,27 +1,533 @@
 #include "../include/server.h"
+#include "../include/content_store.h"
 #include "../include/file_utils.h"
+#include "../include/http1.h"
+#include "../include/topology.h"
+#include "../include/trace.h"
+#include <algorithm>
 #include <arpa/inet.h>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <csignal>
 #include <cstring>
+#include <ctime>
 #include <fcntl.h>
 #include <iostream>
+#include <linux/filter.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <sstream>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
 #include <unistd.h>
 
+namespace {
+const int MAX_EVENTS = 64;
+const size_t READ_BUFFER_SIZE = 16 * 1024;
+const size_t WRITE_CHUNK_SIZE = 64 * 1024;
+const size_t MAX_REQUEST_HEAD = 8 * 1024;
+// Longer request bodies close the connection instead of being skipped
+const size_t MAX_SKIPPED_BODY = 64 * 1024;
+const int ACCEPT_BATCH = 64;       // Connections taken per listener wakeup
+const size_t MAX_IOVECS = 64;      // Segments gathered into one sendmsg
+const size_t MAX_QUEUED_SEGMENTS = 256; // Stop reading past this backlog
+
+void set_option(int fd, int level, int name, int value, const char *label) {
+    if (setsockopt(fd, level, name, &value, sizeof(value)) < 0) {
+        std::cerr << "Warning: failed to set " << label << std::endl;
+    }
+}
+
+// The TCP port a socket is bound to, or -1
+int bound_port(int fd) {
+    struct sockaddr_storage address;
+    socklen_t length = sizeof(address);
+    if (getsockname(fd, (struct sockaddr *)&address, &length) < 0) {
+        return -1;
+    }
+    if (address.ss_family == AF_INET) {
+        return ntohs(((struct sockaddr_in *)&address)->sin_port);
+    }
+    if (address.ss_family == AF_INET6) {
+        return ntohs(((struct sockaddr_in6 *)&address)->sin6_port);
+    }
+    return -1;
+}
+
+// Hands each new connection in fd's SO_REUSEPORT group to the socket at
+// index (receiving CPU mod size). Classic BPF needs no privileges.
+bool attach_cpu_steering(int fd, unsigned size) {
+    struct sock_filter code[] = {
+        {BPF_LD | BPF_W | BPF_ABS, 0, 0,
+         static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)},
+        {BPF_ALU | BPF_MOD | BPF_K, 0, 0, size},
+        {BPF_RET | BPF_A, 0, 0, 0},
+    };
+    struct sock_fprog program;
+    program.len = sizeof(code) / sizeof(code[0]);
+    program.filter = code;
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program,
+                      sizeof(program)) == 0;
+}
+
+// Lowercases a Host value and drops the port and any trailing dot
+std::string host_name(const std::string &host) {
+    std::string name = host;
+    size_t colon = name.rfind(':');
+    if (colon != std::string::npos && name.find(']') == std::string::npos &&
+        name.find(':') == colon) {
+        name.erase(colon); // "example.com:8080"
+    } else if (!name.empty() && name[0] == '[') {
+        name.erase(name.find(']') + 1); // "[::1]:8080"
+    }
+    if (!name.empty() && name[name.size() - 1] == '.') {
+        name.erase(name.size() - 1);
+    }
+    for (size_t i = 0; i < name.size(); ++i) {
+        name[i] =
+            static_cast<char>(tolower(static_cast<unsigned char>(name[i])));
+    }
+    return name;
+}
+
+// True when an Accept-Encoding value lists gzip without q=0
+bool accepts_gzip(const std::string &accept_encoding) {
+    size_t begin = 0;
+    while (begin < accept_encoding.size()) {
+        size_t end = accept_encoding.find(',', begin);
+        if (end == std::string::npos) {
+            end = accept_encoding.size();
+        }
+        size_t token = accept_encoding.find_first_not_of(" \t", begin);
+        if (token < end && strncasecmp(accept_encoding.c_str() + token, "gzip",
+                                       4) == 0) {
+            std::string params =
+                accept_encoding.substr(token + 4, end - token - 4);
+            size_t q = params.find("q=");
+            if (params.find_first_not_of(" \t") == std::string::npos ||
+                params[params.find_first_not_of(" \t")] == ';') {
+                return q == std::string::npos ||
+                       atof(params.c_str() + q + 2) > 0;
+            }
+        }
+        begin = end + 1;
+    }
+    return false;
+}
+
+// RFC 7231 IMF-fixdate
+std::string http_date(time_t when) {
+    struct tm parts;
+    gmtime_r(&when, &parts);
+    char buffer[64];
+    strftime(buffer, sizeof(buffer), "%a, %d %b %Y %H:%M:%S GMT", &parts);
+    return buffer;
+}
+
+// True when an If-None-Match value lists etag or "*". Comparison is weak
+// (RFC 7232 3.2), so "W/" prefixes are ignored.
+bool etag_matches(const std::string &if_none_match, const std::string &etag) {
+    size_t begin = 0;
+    while (begin < if_none_match.size()) {
+        size_t end = if_none_match.find(',', begin);
+        if (end == std::string::npos) {
+            end = if_none_match.size();
+        }
+        size_t first = if_none_match.find_first_not_of(" \t", begin);
+        size_t last = if_none_match.find_last_not_of(" \t", end - 1);
+        if (first < end && last != std::string::npos && last >= first) {
+            std::string tag = if_none_match.substr(first, last + 1 - first);
+            if (tag.compare(0, 2, "W/") == 0) {
+                tag.erase(0, 2);
+            }
+            if (tag == "*" || tag == etag) {
+                return true;
+            }
+        }
+        begin = end + 1;
+    }
+    return false;
+}
+
+// Headers carrying a clock value are rebuilt at least this often
+const time_t HEADER_REFRESH_SECONDS = 60;
+
+// Set by SIGTERM/SIGINT in the prefork master
+volatile sig_atomic_t master_stop_requested = 0;
+
+void request_master_stop(int) { master_stop_requested = 1; }
+
+// A worker process that exits sooner than this is restarted after a pause
+const time_t RESPAWN_BACKOFF_SECONDS = 1;
+
+// An admin client idle this long is dropped so the next can connect
+const time_t ADMIN_TIMEOUT_SECONDS = 5;
+const size_t MAX_ADMIN_LINE = 4096;
+
+bool parse_count(const std::string &word, unsigned long &count) {
+    if (word.empty() || !isdigit((unsigned char)word[0])) {
+        return false;
+    }
+    char *end = nullptr;
+    errno = 0;
+    count = strtoul(word.c_str(), &end, 10);
+    return errno == 0 && *end == '\0';
+}
+
+#ifdef STATIC_SERVER_TRACING
+// eventfd every worker watches; SIGUSR1 makes it readable, so even idle
+// workers wake up, and the first to read it writes the trace
+int trace_event_fd = -1;
+
+void request_trace_dump(int) {
+    int saved_errno = errno;
+    uint64_t one = 1;
+    ssize_t written = write(trace_event_fd, &one, sizeof(one));
+    (void)written;
+    errno = saved_errno;
+}
+
+// The prefork master has no rings of its own; SIGUSR1 sent to it is
+// passed on to the worker processes listed here
+const pid_t *master_children = nullptr;
+size_t master_child_count = 0;
+
+void forward_trace_dump(int) {
+    int saved_errno = errno;
+    for (size_t i = 0; i < master_child_count; ++i) {
+        if (master_children[i] > 0) {
+            kill(master_children[i], SIGUSR1);
+        }
+    }
+    errno = saved_errno;
+}
+#endif
+} // namespace
+
 StaticFileServer::StaticFileServer(const ServerConfig &config)
-    : config(config) {
+    : config(config), replicas(1), rate_limiter(config.rate_limit),
+      next_snapshot(0), stop_fd(-1), stopping(false), process_index(0),
+      control(nullptr), admin_fd(-1), purge_generation(0) {
+    bad_request = build_cached_file(400, "text/plain", "Bad Request");
+    not_found = build_cached_file(404, "text/plain", "Not Found");
+    method_not_allowed = build_cached_file(405, "", "");
+    server_error =
+        build_cached_file(500, "text/plain", "Internal Server Error");
+    too_many_requests =
+        build_cached_file(429, "text/plain", "Too Many Requests");
+
     initialize_mime_types();
+    initialize_memory();
+    initialize_hosts();
+    warm_up(); // Before the listeners open, so first requests hit warm
     initialize_socket();
+
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd < 0) {
+        throw std::runtime_error("Failed to create stop event");
+    }
+    control = admin::map_control();
+    control->log_sample.store(config.log_sample);
+    if (!config.admin_socket.empty()) {
+        admin_fd = admin::open_socket(config.admin_socket);
+    }
 }
 
 StaticFileServer::~StaticFileServer() {
-    if (server_fd >= 0) {
-        close(server_fd);
+    if (!workers.empty() && !config.hot_set.file.empty()) {
+        save_hot_set();
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+        Worker &worker = *workers[i];
+        for (auto it = worker.connections.begin();
+             it != worker.connections.end(); ++it) {
+            close(it->first);
+        }
+        close(worker.epoll_fd);
+    }
+    close_listeners();
+    if (stop_fd >= 0) {
+        close(stop_fd);
+    }
+    if (admin_fd >= 0) {
+        close(admin_fd);
+        unlink(config.admin_socket.c_str());
+    }
+    admin::unmap_control(control);
+}
+
+void StaticFileServer::initialize_memory() {
+    const MemoryConfig &memory = config.memory;
+    if (memory.numa != "off" && memory.numa != "replicate" &&
+        memory.numa != "interleave") {
+        throw std::runtime_error("Unknown NUMA mode: " + memory.numa);
+    }
+    if (memory.numa != "off") {
+        numa_nodes = topology::memory_nodes();
+    }
+
+    // A pool holds one replica of every host's cache, and its mappings,
+    // free slots included, are held to the same budget
+    size_t budget = config.cache_size;
+    for (size_t i = 0; i < config.virtual_hosts.size(); ++i) {
+        budget += config.virtual_hosts[i].cache_size;
+    }
+
+    // Small hot sets are copied to every node so reads stay local; large
+    // ones are interleaved so no single node's bandwidth is the limit
+    if (memory.numa == "replicate") {
+        replicas = numa_nodes.size();
+        for (size_t i = 0; i < numa_nodes.size(); ++i) {
+            pools.push_back(std::unique_ptr<ContentPool>(new ContentPool(
+                memory.huge_pages, numa_nodes[i], numa_nodes, budget)));
+        }
+    } else if (memory.numa == "interleave" || memory.huge_pages) {
+        int node = memory.numa == "interleave" ? ContentPool::INTERLEAVE
+                                               : ContentPool::ANY_NODE;
+        pools.push_back(std::unique_ptr<ContentPool>(
+            new ContentPool(memory.huge_pages, node, numa_nodes, budget)));
+    }
+
+    for (size_t i = 0; i < replicas; ++i) {
+        ContentPool *pool = nullptr;
+        if (!pools.empty()) {
+            pool = pools[pools.size() > 1 ? i : 0].get();
+        }
+        stores.push_back(std::unique_ptr<ContentStore>(new ContentStore(pool)));
+    }
+
+    // Created before warm_up() and before fork, so every worker process
+    // maps the same segment
+    if (config.processes > 0) {
+        shared_cache.reset(
+            new SharedCache(config.shared_cache_size, memory.huge_pages));
+    }
+}
+
+StaticFileServer::VirtualHost::~VirtualHost() {
+    if (root_fd >= 0) {
+        close(root_fd);
+    }
+}
+
+void StaticFileServer::initialize_hosts() {
+    // The top-level settings form the default host
+    VirtualHostConfig fallback;
+    fallback.root_directory = config.root_directory;
+    fallback.cache_size = config.cache_size;
+    fallback.precompressed = config.precompressed;
+    fallback.error_pages = config.error_pages;
+    fallback.cache_rules = config.cache_rules;
+    hosts.push_back(open_host(fallback));
+
+    for (size_t i = 0; i < config.virtual_hosts.size(); ++i) {
+        hosts.push_back(open_host(config.virtual_hosts[i]));
+        const std::vector<std::string> &names =
+            config.virtual_hosts[i].server_names;
+        for (size_t n = 0; n < names.size(); ++n) {
+            std::string name = host_name(names[n]);
+            if (!hosts_by_name.insert(std::make_pair(name, hosts.back().get()))
+                     .second) {
+                throw std::runtime_error("Duplicate server name: " + name);
+            }
+        }
+    }
+}
+
+std::string StaticFileServer::host_label(const VirtualHost &host) const {
+    if (host.config.server_names.empty()) {
+        return "*";
+    }
+    return host_name(host.config.server_names[0]);
+}
+
+std::vector<hot_set::Entry> StaticFileServer::collect_hot_set(size_t limit,
+                                                              bool decay) {
+    std::vector<hot_set::Entry> entries;
+    for (size_t i = 0; i < hosts.size(); ++i) {
+        VirtualHost &host = *hosts[i];
+        hot_set::Entry entry;
+        entry.host = host_label(host);
+        // Replicas hold the same paths; the first one's counts stand in
+        // for all of them
+        std::vector<std::pair<std::string, uint64_t>> hot =
+            host.caches[0]->hot_set(limit, decay);
+        for (size_t h = 0; h < hot.size(); ++h) {
+            entry.key = hot[h].first;
+            entry.hits = hot[h].second;
+            entries.push_back(entry);
+        }
+
+        // Uncached files age the same way as cache entries
+        std::lock_guard<std::mutex> lock(host.hits_mutex);
+        for (auto it = host.uncached_hits.begin();
+             it != host.uncached_hits.end(); ++it) {
+            entry.key = it->first;
+            entry.hits = it->second;
+            entries.push_back(entry);
+            if (decay) {
+                it->second /= 2;
+            }
+        }
+    }
+
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const hot_set::Entry &a, const hot_set::Entry &b) {
+                         return a.hits > b.hits;
+                     });
+    if (entries.size() > limit) {
+        entries.resize(limit);
+    }
+    return entries;
+}
+
+void StaticFileServer::save_hot_set() {
+    std::vector<hot_set::Entry> entries =
+        collect_hot_set(config.hot_set.max_entries, true);
+    if (entries.empty()) {
+        return; // Keep the previous snapshot rather than an idle one
+    }
+    if (!hot_set::save(config.hot_set.file, entries)) {
+        std::cerr << "Warning: cannot write hot set " << config.hot_set.file
+                  << std::endl;
     }
 }
 
+void StaticFileServer::warm_up() {
+    if (config.hot_set.file.empty()) {
+        return;
+    }
+    std::vector<hot_set::Entry> entries = hot_set::load(config.hot_set.file);
+    if (entries.size() > config.hot_set.max_entries) {
+        entries.resize(config.hot_set.max_entries);
+    }
+    if (entries.empty()) {
+        return;
+    }
+
+    // Workers claim entries in order of heat. load_file only touches the
+    // locked caches and read-only server state, so they can share it.
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> warmed(0);
+    auto worker = [this, &entries, &next, &warmed]() {
+        for (size_t i = next++; i < entries.size(); i = next++) {
+            const hot_set::Entry &entry = entries[i];
+            VirtualHost *host = hosts[0].get();
+            if (entry.host != "*") {
+                auto it = hosts_by_name.find(entry.host);
+                if (it == hosts_by_name.end()) {
+                    continue; // The host was removed from the config
+                }
+                host = it->second;
+            }
+
+            bool gzip = entry.key.compare(0, 5, "gzip:") == 0;
+            std::string path = entry.key.substr(gzip ? 5 : 0);
+            if (host->root_fd < 0 || path.empty() || path[0] != '/' ||
+                !file_utils::normalize_path(path)) {
+                continue;
+            }
+
+            // Small files go into the response cache; larger ones are only
+            // pulled into the page cache
+            std::string relative = path.substr(1) + (gzip ? ".gz" : "");
+            struct stat file_stat;
+            if (fstatat(host->root_fd, relative.c_str(), &file_stat, 0) < 0 ||
+                !S_ISREG(file_stat.st_mode)) {
+                continue;
+            }
+            size_t size = static_cast<size_t>(file_stat.st_size);
+            if (size <= config.max_cached_file_size) {
+                bool loaded = true;
+                for (size_t r = 0; r < replicas; ++r) {
+                    loaded &= load_file(*host, path, gzip, r)->status == 200;
+                }
+                if (loaded) {
+                    ++warmed;
+                }
+                continue;
+            }
+            int fd = file_utils::open_beneath(host->root_fd, relative.c_str());
+            if (fd >= 0) {
+                if (file_utils::prefetch_fd(fd, size)) {
+                    ++warmed;
+                }
+                close(fd);
+            }
+        }
+    };
+
+    unsigned threads = std::max(1u, config.hot_set.warmup_threads);
+    threads = static_cast<unsigned>(
+        std::min<size_t>(threads, entries.size()));
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threads; ++i) {
+        workers.push_back(std::thread(worker));
+    }
+    worker();
+    for (size_t i = 0; i < workers.size(); ++i) {
+        workers[i].join();
+    }
+    std::cout << "Warmed " << warmed.load() << " of " << entries.size()
+              << " hot paths" << std::endl;
+}
+
+std::unique_ptr<StaticFileServer::VirtualHost>
+StaticFileServer::open_host(const VirtualHostConfig &host_config) {
+    std::unique_ptr<VirtualHost> host(new VirtualHost());
+    host->config = host_config;
+    for (size_t i = 0; i < replicas; ++i) {
+        host->caches.push_back(
+            std::unique_ptr<FileCache>(new FileCache(host_config.cache_size)));
+    }
+    host->policy.reset(new CachePolicy(host_config.cache_rules));
+
+    // Requests are resolved relative to this descriptor, so the root prefix
+    // is walked once here instead of on every open.
+    host->root_fd = open(host_config.root_directory.c_str(),
+                         O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (host->root_fd < 0) {
+        std::cerr << "Warning: cannot open root directory "
+                  << host_config.root_directory << std::endl;
+        return host;
+    }
+
+    // Custom error pages are read once and kept for the server's lifetime
+    for (auto it = host_config.error_pages.begin();
+         it != host_config.error_pages.end(); ++it) {
+        std::string path = it->second;
+        int fd = -1;
+        if (!path.empty() && path[0] == '/' &&
+            file_utils::normalize_path(path)) {
+            fd = file_utils::open_beneath(host->root_fd, path.c_str() + 1);
+        }
+        if (fd < 0) {
+            std::cerr << "Warning: cannot open error page " << it->second
+                      << std::endl;
+            continue;
+        }
+        try {
+            host->error_pages[it->first] = build_cached_file(
+                it->first, get_content_type(path), file_utils::read_fd(fd));
+        } catch (const std::exception &) {
+            std::cerr << "Warning: cannot read error page " << it->second
+                      << std::endl;
+        }
+        close(fd);
+    }
+    return host;
+}
+
 void StaticFileServer::initialize_mime_types() {
     mime_types = {
         {".html", "text/html"},        {".htm", "text/html"},
@@ -34,162 +540,1453 @@ void StaticFileServer::initialize_mime_types() {
 }
 
 void StaticFileServer::initialize_socket() {
+    close_listeners(); // Re-initialization replaces the old listeners
+
+    std::vector<ListenerConfig> wanted = config.listeners;
+    if (wanted.empty()) {
+        ListenerConfig listener;
+        listener.port = config.port;
+        wanted.push_back(listener);
+    }
+
+    // With reuseport every worker thread, counted across processes, gets
+    // a socket of its own in one SO_REUSEPORT group. Sockets join the
+    // group in worker order, which is the index the steering returns.
+    unsigned group_size =
+        std::max(1u, config.workers) * std::max(1u, config.processes);
+    for (size_t i = 0; i < wanted.size(); ++i) {
+        ListenerConfig group = wanted[i];
+        if (group.reuseport != "off" &&
+            group.address.compare(0, 5, "unix:") == 0) {
+            std::cerr << "Warning: reuseport does not apply to "
+                      << group.address << std::endl;
+            group.reuseport = "off";
+        }
+        bool per_worker = group.reuseport != "off";
+        size_t first = listeners.size();
+        for (unsigned w = 0; w < (per_worker ? group_size : 1); ++w) {
+            Listener listener;
+            listener.config = group;
+            listener.worker = per_worker ? static_cast<int>(w) : -1;
+            try {
+                listener.fd = open_listener(group);
+            } catch (const std::exception &) {
+                close_listeners();
+                throw;
+            }
+            listeners.push_back(listener);
+            if (group.port == 0) {
+                group.port = bound_port(listener.fd); // Join the same port
+            }
+        }
+
+        if (group.reuseport == "cpu") {
+            if (!attach_cpu_steering(listeners[first].fd, group_size)) {
+                std::cerr << "Warning: cannot attach reuseport CPU "
+                             "steering; using the kernel's hash"
+                          << std::endl;
+            } else if (group_size > topology::online_cpus().size()) {
+                std::cerr << "Warning: reuseport CPU steering leaves "
+                             "workers beyond the CPU count idle"
+                          << std::endl;
+            }
+        }
+    }
+}
+
+void StaticFileServer::close_listeners() {
+    for (size_t i = 0; i < listeners.size(); ++i) {
+        close(listeners[i].fd);
+        const std::string &address = listeners[i].config.address;
+        if (address.compare(0, 5, "unix:") == 0) {
+            unlink(address.c_str() + 5);
+        }
+    }
+    listeners.clear();
+}
+
+int StaticFileServer::open_listener(const ListenerConfig &listener) {
+    struct sockaddr_storage storage;
+    memset(&storage, 0, sizeof(storage));
+    socklen_t length;
+    bool is_unix = listener.address.compare(0, 5, "unix:") == 0;
+
+    // Resolve the listen address
+    if (is_unix) {
+        struct sockaddr_un *un = (struct sockaddr_un *)&storage;
+        std::string path = listener.address.substr(5);
+        if (path.empty() || path.size() >= sizeof(un->sun_path)) {
+            throw std::runtime_error("Invalid Unix socket path: " + path);
+        }
+        un->sun_family = AF_UNIX;
+        memcpy(un->sun_path, path.c_str(), path.size() + 1);
+        length = sizeof(struct sockaddr_un);
+        unlink(path.c_str()); // Remove a stale socket from a previous run
+    } else if (listener.address.find(':') != std::string::npos) {
+        struct sockaddr_in6 *in6 = (struct sockaddr_in6 *)&storage;
+        in6->sin6_family = AF_INET6;
+        in6->sin6_port = htons(listener.port);
+        if (inet_pton(AF_INET6, listener.address.c_str(), &in6->sin6_addr) !=
+            1) {
+            throw std::runtime_error("Invalid IPv6 address: " +
+                                     listener.address);
+        }
+        length = sizeof(struct sockaddr_in6);
+    } else {
+        struct sockaddr_in *in = (struct sockaddr_in *)&storage;
+        in->sin_family = AF_INET;
+        in->sin_port = htons(listener.port);
+        if (inet_pton(AF_INET, listener.address.c_str(), &in->sin_addr) != 1) {
+            throw std::runtime_error("Invalid IPv4 address: " +
+                                     listener.address);
+        }
+        length = sizeof(struct sockaddr_in);
+    }
+
     // Create socket
-    server_fd = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_fd < 0) {
+    int fd = socket(storage.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
         throw std::runtime_error("Failed to create socket");
     }
 
     // Set socket options
     int opt = 1;
-    if (setsockopt(server_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) <
-        0) {
-        close(server_fd);
+    if (!is_unix &&
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        close(fd);
         throw std::runtime_error("Failed to set socket options");
     }
+    if (listener.reuseport != "off" &&
+        setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to set SO_REUSEPORT");
+    }
+    if (storage.ss_family == AF_INET6) {
+        int v6_only = listener.v6_only ? 1 : 0;
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &v6_only, sizeof(v6_only));
+    }
 
-    // Bind socket to port
-    struct sockaddr_in address;
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(config.port);
+    // Tuning options are best effort; accepted sockets inherit them
+    if (!is_unix) {
+        if (listener.nodelay) {
+            set_option(fd, IPPROTO_TCP, TCP_NODELAY, 1, "TCP_NODELAY");
+        }
+        if (listener.defer_accept > 0) {
+            set_option(fd, IPPROTO_TCP, TCP_DEFER_ACCEPT,
+                       listener.defer_accept, "TCP_DEFER_ACCEPT");
+        }
+        if (listener.fastopen > 0) {
+            set_option(fd, IPPROTO_TCP, TCP_FASTOPEN, listener.fastopen,
+                       "TCP_FASTOPEN");
+        }
+    }
+    if (listener.send_buffer > 0) {
+        set_option(fd, SOL_SOCKET, SO_SNDBUF, listener.send_buffer,
+                   "SO_SNDBUF");
+    }
 
-    if (bind(server_fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
-        close(server_fd);
-        throw std::runtime_error("Failed to bind socket to port");
+    // Bind socket to the address
+    if (bind(fd, (struct sockaddr *)&storage, length) < 0) {
+        close(fd);
+        throw std::runtime_error("Failed to bind socket to " +
+                                 listener.address + " port " +
+                                 std::to_string(listener.port));
     }
 
     // Start listening
-    if (listen(server_fd, 10) < 0) {
-        close(server_fd);
+    if (listen(fd, listener.backlog) < 0) {
+        close(fd);
         throw std::runtime_error("Failed to listen on socket");
     }
+    return fd;
 }
 
 void StaticFileServer::start() {
     std::cout << "Server started. Press Ctrl+C to stop.\n" << std::endl;
+    if (config.processes > 0) {
+        run_master();
+    } else {
+        serve();
+    }
+}
 
-    struct sockaddr_in client_addr;
-    socklen_t client_addr_len = sizeof(client_addr);
+void StaticFileServer::serve() {
+    // The admin socket is answered by the process that serves requests
+    // (the first worker process in prefork mode), on a thread of its own
+    std::thread admin_thread;
+    if (admin_fd >= 0) {
+        admin_thread = std::thread(&StaticFileServer::run_admin, this);
+    }
+    try {
+        run_workers();
+    } catch (...) {
+        if (admin_thread.joinable()) {
+            stop();
+            admin_thread.join();
+        }
+        throw;
+    }
+    if (admin_thread.joinable()) {
+        stop();
+        admin_thread.join();
+    }
+}
 
-    while (true) {
-        int client_socket = accept(server_fd, (struct sockaddr *)&client_addr,
-                                   &client_addr_len);
-        if (client_socket < 0) {
-            std::cerr << "Failed to accept connection" << std::endl;
+void StaticFileServer::stop() {
+    stopping.store(true);
+    uint64_t one = 1;
+    if (write(stop_fd, &one, sizeof(one)) < 0) {
+        std::cerr << "Warning: failed to signal stop" << std::endl;
+    }
+}
+
+int StaticFileServer::local_port() const {
+    for (size_t i = 0; i < listeners.size(); ++i) {
+        int port = bound_port(listeners[i].fd);
+        if (port >= 0) {
+            return port;
+        }
+    }
+    return -1;
+}
+
+void StaticFileServer::run_admin() {
+    struct pollfd fds[2];
+    fds[0].fd = admin_fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = stop_fd;
+    fds[1].events = POLLIN;
+    while (!stopping.load()) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "Warning: admin socket poll failed" << std::endl;
+            return;
+        }
+        if (fds[1].revents != 0) {
+            return; // stop_fd stays readable, so the workers see it too
+        }
+        if (fds[0].revents == 0) {
+            continue;
+        }
+        int client = accept4(admin_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
             continue;
         }
+        handle_admin_client(client);
+        close(client);
+    }
+}
 
-        // Get client IP
-        char client_ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &client_addr.sin_addr, client_ip, INET_ADDRSTRLEN);
-        std::cout << "Connection from " << client_ip << std::endl;
+void StaticFileServer::handle_admin_client(int fd) {
+    // Clients are served one at a time; an idle one is dropped
+    struct timeval timeout;
+    timeout.tv_sec = ADMIN_TIMEOUT_SECONDS;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
 
-        // Handle the connection
-        handle_connection(client_socket);
-        close(client_socket);
+    std::string input;
+    char buffer[1024];
+    while (!stopping.load()) {
+        size_t newline = input.find('\n');
+        if (newline == std::string::npos) {
+            if (input.size() > MAX_ADMIN_LINE) {
+                return;
+            }
+            ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                return;
+            }
+            input.append(buffer, received);
+            continue;
+        }
+
+        std::string line = input.substr(0, newline);
+        input.erase(0, newline + 1);
+        std::vector<std::string> words = admin::split(line);
+        if (words.size() == 1 && words[0] == "quit") {
+            return;
+        }
+
+        std::string reply = admin_command(line);
+        size_t sent = 0;
+        while (sent < reply.size()) {
+            ssize_t written = send(fd, reply.data() + sent,
+                                   reply.size() - sent, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return;
+            }
+            sent += written;
+        }
     }
 }
 
-void StaticFileServer::handle_connection(int client_socket) {
-    // Read request
-    char buffer[1024] = {0};
-    int bytes_read = read(client_socket, buffer, sizeof(buffer) - 1);
+std::string StaticFileServer::admin_command(const std::string &line) {
+    std::vector<std::string> words = admin::split(line);
+    if (words.empty()) {
+        return "ERROR empty command\n";
+    }
+    std::lock_guard<std::mutex> lock(admin_mutex);
+    const std::string &command = words[0];
 
-    if (bytes_read <= 0) {
-        std::cerr << "Failed to read from client" << std::endl;
-        return;
+    if (command == "stats" && words.size() == 1) {
+        return admin_stats();
+    }
+    if (command == "top" && words.size() <= 2) {
+        unsigned long limit = 10;
+        if (words.size() == 2 && (!parse_count(words[1], limit) ||
+                                  limit == 0)) {
+            return "ERROR invalid count " + words[1] + "\n";
+        }
+        return admin_top(limit);
     }
+    if (command == "purge" || command == "warm") {
+        // Paths start with '/'; a word before them names the host
+        size_t first = 1;
+        std::string host;
+        if (words.size() > 1 && words[1][0] != '/') {
+            host = words[1];
+            first = 2;
+        }
+        if (first >= words.size()) {
+            return "ERROR missing path\n";
+        }
+        std::vector<VirtualHost *> targets = admin_hosts(host);
+        if (targets.empty()) {
+            return "ERROR unknown host " + host + "\n";
+        }
+        if (command == "warm") {
+            return admin_warm(targets, std::vector<std::string>(
+                                           words.begin() + first,
+                                           words.end()));
+        }
+        if (words.size() != first + 1) {
+            return "ERROR purge takes one path or prefix\n";
+        }
+        return admin_purge(targets, words[first]);
+    }
+    if (command == "log" && words.size() == 2) {
+        unsigned long sample = 0;
+        if (!parse_count(words[1], sample) || sample > UINT32_MAX) {
+            return "ERROR invalid sample " + words[1] + "\n";
+        }
+        control->log_sample.store(sample);
+        return "log_sample " + std::to_string(sample) + "\nOK\n";
+    }
+    if (command == "help") {
+        return "stats\n"
+               "top [N]\n"
+               "purge [host] <path|prefix*>\n"
+               "warm [host] <path>...\n"
+               "log <N>\n"
+               "quit\n"
+               "OK\n";
+    }
+    return "ERROR unknown command " + line + "\n";
+}
 
-    std::string request(buffer);
+std::vector<StaticFileServer::VirtualHost *>
+StaticFileServer::admin_hosts(const std::string &name) {
+    // No name means every host; "*" is the default (first) host
+    std::vector<VirtualHost *> targets;
+    if (name.empty()) {
+        for (size_t i = 0; i < hosts.size(); ++i) {
+            targets.push_back(hosts[i].get());
+        }
+    } else if (name == "*") {
+        targets.push_back(hosts[0].get());
+    } else {
+        auto it = hosts_by_name.find(host_name(name));
+        if (it != hosts_by_name.end()) {
+            targets.push_back(it->second);
+        }
+    }
+    return targets;
+}
 
-    // Parse request to get the path
-    std::string path, method;
-    parse_request(request, path, method);
+std::string StaticFileServer::admin_stats() {
+    uint64_t accepted = 0, closed = 0, requests = 0;
+    for (size_t i = 0; i < admin::MAX_COUNTERS; ++i) {
+        accepted += control->counters[i].accepted.load();
+        closed += control->counters[i].closed.load();
+        requests += control->counters[i].requests.load();
+    }
 
-    // Only handle GET requests
-    if (method != "GET") {
-        std::string response = "HTTP/1.1 405 Method Not Allowed\r\n"
-                               "Content-Length: 0\r\n"
-                               "\r\n";
-        send(client_socket, response.c_str(), response.length(), 0);
+    std::ostringstream out;
+    out << "connections_open " << accepted - closed << "\n"
+        << "connections_accepted " << accepted << "\n"
+        << "requests " << requests << "\n";
+    for (size_t i = 0; i < hosts.size(); ++i) {
+        size_t entries = 0, bytes = 0;
+        for (size_t r = 0; r < hosts[i]->caches.size(); ++r) {
+            entries += hosts[i]->caches[r]->entry_count();
+            bytes += hosts[i]->caches[r]->size_bytes();
+        }
+        out << "host " << host_label(*hosts[i]) << " entries " << entries
+            << " bytes " << bytes << "\n";
+    }
+    size_t bodies = 0;
+    uint64_t deduplicated = 0;
+    for (size_t r = 0; r < stores.size(); ++r) {
+        bodies += stores[r]->entry_count();
+        deduplicated += stores[r]->deduplicated();
+    }
+    out << "bodies " << bodies << " deduplicated " << deduplicated << "\n";
+    if (!pools.empty()) {
+        size_t mapped = 0;
+        for (size_t i = 0; i < pools.size(); ++i) {
+            mapped += pools[i]->mapped_bytes();
+        }
+        out << "pool_mapped " << mapped << "\n";
+    }
+    if (shared_cache) {
+        out << "shared_cache used " << shared_cache->used_bytes()
+            << " capacity " << shared_cache->capacity() << "\n";
+    }
+    out << "log_sample " << control->log_sample.load() << "\nOK\n";
+    return out.str();
+}
+
+std::string StaticFileServer::admin_top(size_t limit) {
+    std::vector<hot_set::Entry> entries = collect_hot_set(limit, false);
+    std::ostringstream out;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        out << entries[i].hits << " " << entries[i].host << " "
+            << entries[i].key << "\n";
+    }
+    out << "OK\n";
+    return out.str();
+}
+
+std::string
+StaticFileServer::admin_purge(const std::vector<VirtualHost *> &targets,
+                              const std::string &pattern) {
+    // A trailing '*' purges every key starting with the rest
+    bool prefix = pattern[pattern.size() - 1] == '*';
+    std::string path = pattern.substr(0, pattern.size() - (prefix ? 1 : 0));
+    if (!prefix && !file_utils::request_key(pattern, path)) {
+        return "ERROR invalid path " + pattern + "\n";
+    }
+
+    size_t purged = 0;
+    for (size_t i = 0; i < targets.size(); ++i) {
+        VirtualHost &host = *targets[i];
+        for (size_t r = 0; r < host.caches.size(); ++r) {
+            FileCache &cache = *host.caches[r];
+            if (prefix) {
+                purged += cache.erase_prefix(path);
+                purged += cache.erase_prefix("gzip:" + path);
+            } else {
+                purged += cache.erase(path);
+                purged += cache.erase("gzip:" + path);
+            }
+        }
+        if (shared_cache) {
+            std::string label = host_label(host) + '\n';
+            purged += shared_cache->erase(label + path, prefix);
+            purged += shared_cache->erase(label + "gzip:" + path, prefix);
+        }
+    }
+    if (shared_cache) {
+        // Other processes drop their local copies on their next lookup
+        control->purge_generation.fetch_add(1);
+    }
+    return "purged " + std::to_string(purged) + "\nOK\n";
+}
+
+std::string
+StaticFileServer::admin_warm(const std::vector<VirtualHost *> &targets,
+                             const std::vector<std::string> &paths) {
+    size_t warmed = 0, missing = 0;
+    for (size_t i = 0; i < targets.size(); ++i) {
+        for (size_t p = 0; p < paths.size(); ++p) {
+            std::string path;
+            if (!file_utils::request_key(paths[p], path)) {
+                ++missing;
+                continue;
+            }
+            bool loaded = true;
+            for (size_t r = 0; r < replicas; ++r) {
+                std::shared_ptr<const CachedFile> file =
+                    load_file(*targets[i], path, false, r);
+                loaded &= file->status == 200;
+                if (file->gzip_variant) {
+                    load_file(*targets[i], path, true, r);
+                }
+            }
+            if (loaded) {
+                ++warmed;
+            } else {
+                ++missing;
+            }
+        }
+    }
+    return "warmed " + std::to_string(warmed) + " missing " +
+           std::to_string(missing) + "\nOK\n";
+}
+
+void StaticFileServer::apply_purges() {
+    // A purge reaches the shared segment directly; the local caches of
+    // every process are dropped wholesale and refill from it
+    uint64_t generation = control->purge_generation.load();
+    if (purge_generation.load(std::memory_order_relaxed) == generation ||
+        purge_generation.exchange(generation) == generation) {
         return;
     }
+    for (size_t i = 0; i < hosts.size(); ++i) {
+        for (size_t r = 0; r < hosts[i]->caches.size(); ++r) {
+            hosts[i]->caches[r]->clear();
+        }
+    }
+}
+
+void StaticFileServer::run_master() {
+    // No SA_RESTART, so a stop signal interrupts waitpid()
+    struct sigaction stop;
+    memset(&stop, 0, sizeof(stop));
+    stop.sa_handler = request_master_stop;
+    sigemptyset(&stop.sa_mask);
+    sigaction(SIGTERM, &stop, nullptr);
+    sigaction(SIGINT, &stop, nullptr);
+
+    // Workers inherit the listeners and the shared cache mapping
+    std::vector<pid_t> children(config.processes, -1);
+    std::vector<time_t> started(config.processes, 0);
+
+    // SIGUSR1 asks for a trace dump, which only the workers can write;
+    // without tracing it must not kill the master either
+#ifdef STATIC_SERVER_TRACING
+    master_children = children.data();
+    master_child_count = children.size();
+    struct sigaction dump = stop;
+    dump.sa_handler = forward_trace_dump;
+    sigaction(SIGUSR1, &dump, nullptr);
+#else
+    signal(SIGUSR1, SIG_IGN);
+#endif
+    for (unsigned i = 0; i < config.processes; ++i) {
+        children[i] = spawn_process(i);
+        started[i] = time(nullptr);
+    }
+
+    while (!master_stop_requested) {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        auto it = std::find(children.begin(), children.end(), pid);
+        if (it == children.end() || master_stop_requested) {
+            continue;
+        }
+
+        // The cache lives in the shared segment, so the replacement
+        // starts warm
+        unsigned index = static_cast<unsigned>(it - children.begin());
+        std::cerr << "Warning: worker process " << pid << " exited ("
+                  << (WIFSIGNALED(status) ? "signal " : "status ")
+                  << (WIFSIGNALED(status) ? WTERMSIG(status)
+                                          : WEXITSTATUS(status))
+                  << "), restarting" << std::endl;
+        if (time(nullptr) - started[index] < RESPAWN_BACKOFF_SECONDS) {
+            sleep(RESPAWN_BACKOFF_SECONDS); // Do not spin on a crash loop
+        }
+        children[index] = spawn_process(index);
+        started[index] = time(nullptr);
+    }
+
+    for (size_t i = 0; i < children.size(); ++i) {
+        if (children[i] > 0) {
+            kill(children[i], SIGTERM);
+        }
+    }
+    for (size_t i = 0; i < children.size(); ++i) {
+        if (children[i] > 0) {
+            waitpid(children[i], nullptr, 0);
+        }
+    }
+#ifdef STATIC_SERVER_TRACING
+    signal(SIGUSR1, SIG_IGN); // children is about to go away
+    master_child_count = 0;
+#endif
+}
+
+pid_t StaticFileServer::spawn_process(unsigned index) {
+    pid_t master = getpid();
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "Warning: cannot fork worker process " << index
+                  << std::endl;
+        return -1;
+    }
+    if (pid > 0) {
+        return pid;
+    }
+
+    // Child: exit with the master and never run its destructors
+    signal(SIGTERM, SIG_DFL);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGUSR1, SIG_IGN); // Until the workers can answer it
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+    if (getppid() != master) {
+        _exit(1); // The master died before the death signal was armed
+    }
+    // The stop event inherited from the master is shared by every
+    // process; a private one keeps stop() here from ending the others
+    close(stop_fd);
+    stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (stop_fd < 0) {
+        std::cerr << "Error: cannot create stop event" << std::endl;
+        _exit(1);
+    }
+    stopping.store(false);
+    process_index = index;
+    config.trace_file += "." + std::to_string(index); // One file each
+    if (index != 0) {
+        config.hot_set.file.clear(); // One process writes the snapshot
+        if (admin_fd >= 0) {
+            close(admin_fd); // Only the first process answers it
+            admin_fd = -1;
+        }
+    }
+    try {
+        serve();
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+    _exit(1);
+}
+
+void StaticFileServer::run_workers() {
+    for (size_t i = 0; i < listeners.size(); ++i) {
+        int fd = listeners[i].fd;
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    }
+
+    // CPU steering only keeps a connection local if the worker it picks
+    // runs on the CPU that received it
+    bool cpu_steering = false;
+    for (size_t i = 0; i < listeners.size(); ++i) {
+        cpu_steering |= listeners[i].config.reuseport == "cpu";
+    }
+    std::vector<int> cpus;
+    if (cpu_steering && numa_nodes.empty()) {
+        cpus = topology::online_cpus();
+    }
+
+    // Every worker watches every shared listener; EPOLLEXCLUSIVE wakes
+    // only one of them per incoming connection. Reuseport sockets each
+    // have a single watcher.
+#ifdef STATIC_SERVER_TRACING
+    if (trace_event_fd < 0) {
+        trace_event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (trace_event_fd < 0) {
+            throw std::runtime_error("Failed to create trace event");
+        }
+    }
+#endif
+
+    unsigned count = std::max(1u, config.workers);
+    for (unsigned i = 0; i < count; ++i) {
+        int global = static_cast<int>(process_index * count + i);
+        std::unique_ptr<Worker> worker(new Worker());
+        worker->id = i;
+        worker->node = numa_nodes.empty() ? -1
+                                           : numa_nodes[i % numa_nodes.size()];
+        worker->cpu =
+            std::find(cpus.begin(), cpus.end(), global) != cpus.end()
+                ? global
+                : -1;
+        worker->replica = replicas > 1 ? i % replicas : 0;
+        worker->counters =
+            &control->counters[(process_index * count + i) %
+                               admin::MAX_COUNTERS];
+        worker->accepted = 0;
+        worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (worker->epoll_fd < 0) {
+            throw std::runtime_error("Failed to create epoll instance");
+        }
+        workers.push_back(std::move(worker));
+
+        for (size_t l = 0; l < listeners.size(); ++l) {
+            bool shared = listeners[l].worker < 0;
+            if (!shared && listeners[l].worker != global) {
+                continue;
+            }
+            workers[i]->listeners.push_back(&listeners[l]);
+            struct epoll_event listen_event;
+            listen_event.events =
+                EPOLLIN | (shared && count > 1 ? EPOLLEXCLUSIVE : 0);
+            listen_event.data.fd = listeners[l].fd;
+            if (epoll_ctl(workers[i]->epoll_fd, EPOLL_CTL_ADD,
+                          listeners[l].fd, &listen_event) < 0) {
+                throw std::runtime_error("Failed to watch listening socket");
+            }
+        }
+
+        // The stop event stays readable, so it wakes every worker
+        struct epoll_event stop_event;
+        stop_event.events = EPOLLIN;
+        stop_event.data.fd = stop_fd;
+        if (epoll_ctl(workers[i]->epoll_fd, EPOLL_CTL_ADD, stop_fd,
+                      &stop_event) < 0) {
+            throw std::runtime_error("Failed to watch stop event");
+        }
+#ifdef STATIC_SERVER_TRACING
+        struct epoll_event trace_event;
+        trace_event.events = EPOLLIN;
+        trace_event.data.fd = trace_event_fd;
+        if (epoll_ctl(workers[i]->epoll_fd, EPOLL_CTL_ADD, trace_event_fd,
+                      &trace_event) < 0) {
+            throw std::runtime_error("Failed to watch trace event");
+        }
+#endif
+    }
+
+#ifdef STATIC_SERVER_TRACING
+    signal(SIGUSR1, request_trace_dump);
+#endif
 
-    // Send response
-    send_response(client_socket, path);
+    // The calling thread runs the first worker
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < workers.size(); ++i) {
+        Worker *worker = workers[i].get();
+        threads.push_back(std::thread(&StaticFileServer::run_worker, this,
+                                      std::ref(*worker)));
+    }
+    run_worker(*workers[0]);
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
 }
 
-void StaticFileServer::parse_request(const std::string &request,
-                                     std::string &path, std::string &method) {
-    std::istringstream request_stream(request);
+void StaticFileServer::run_worker(Worker &worker) {
+    if (worker.node >= 0 && !topology::bind_thread(worker.node)) {
+        std::cerr << "Warning: cannot bind worker " << worker.id
+                  << " to NUMA node " << worker.node << std::endl;
+    }
+    if (worker.cpu >= 0 && !topology::bind_cpu(worker.cpu)) {
+        std::cerr << "Warning: cannot pin worker " << worker.id
+                  << " to CPU " << worker.cpu << std::endl;
+    }
+
+    unsigned snapshot_interval = std::max(1u, config.hot_set.interval);
+    if (worker.id == 0) {
+        next_snapshot = time(nullptr) + snapshot_interval;
+    }
+
+    struct epoll_event events[MAX_EVENTS];
+    while (!stopping.load()) {
+        // Wake up for the periodic hot-set snapshot when one is configured
+        int timeout = -1;
+        if (worker.id == 0 && !config.hot_set.file.empty()) {
+            time_t now = time(nullptr);
+            if (now >= next_snapshot) {
+                save_hot_set();
+                next_snapshot = now + snapshot_interval;
+            }
+            timeout = static_cast<int>(next_snapshot - now) * 1000;
+        }
 
-    // Get the first line
-    std::string first_line;
-    std::getline(request_stream, first_line, '\r');
+        int ready = epoll_wait(worker.epoll_fd, events, MAX_EVENTS, timeout);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("epoll_wait failed");
+        }
 
-    // Parse the first line
-    std::istringstream first_line_stream(first_line);
-    first_line_stream >> method >> path;
+        for (int i = 0; i < ready; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == stop_fd) {
+                return;
+            }
+#ifdef STATIC_SERVER_TRACING
+            if (fd == trace_event_fd) {
+                uint64_t dumps;
+                if (read(trace_event_fd, &dumps, sizeof(dumps)) > 0 &&
+                    !trace::write_json(config.trace_file)) {
+                    std::cerr << "Warning: cannot write trace "
+                              << config.trace_file << std::endl;
+                }
+                continue;
+            }
+#endif
+            const Listener *listener = find_listener(worker, fd);
+            if (listener != nullptr) {
+                accept_connection(worker, *listener);
+                continue;
+            }
 
-    // Ensure path starts from root directory
-    if (path == "/") {
-        path = "/index.html"; // Default to index.html
+            auto it = worker.connections.find(fd);
+            if (it == worker.connections.end()) {
+                continue;
+            }
+            Connection &conn = *it->second;
+            bool keep = (events[i].events & EPOLLERR) == 0;
+            if (keep && (events[i].events & (EPOLLIN | EPOLLHUP))) {
+                keep = handle_connection(conn);
+            }
+            if (keep) {
+                keep = flush_connection(conn);
+            }
+            if (!keep) {
+                close_connection(worker, fd);
+            }
+        }
     }
+}
 
-    // Remove URL parameters if any
-    size_t param_pos = path.find('?');
-    if (param_pos != std::string::npos) {
-        path = path.substr(0, param_pos);
+void StaticFileServer::accept_connection(Worker &worker,
+                                         const Listener &listener) {
+    // Drain the backlog, leaving the rest of a burst to the next wakeup
+    // (or to another worker) so accepting cannot starve open connections
+    for (int i = 0; i < ACCEPT_BATCH; ++i) {
+        TRACE_SCOPE(ACCEPT, listener.fd);
+        struct sockaddr_storage client_addr;
+        socklen_t client_addr_len = sizeof(client_addr);
+        int client_socket =
+            accept4(listener.fd, (struct sockaddr *)&client_addr,
+                    &client_addr_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_socket < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "Failed to accept connection" << std::endl;
+            }
+            return;
+        }
+        add_connection(worker, client_socket, client_addr);
     }
 }
 
-void StaticFileServer::send_response(int client_socket,
-                                     const std::string &path) {
-    // Form the full file path
-    std::string full_path = config.root_directory + path;
+void StaticFileServer::add_connection(
+    Worker &worker, int client_socket,
+    const struct sockaddr_storage &client_addr) {
+    // Get client IP
+    char client_ip[INET6_ADDRSTRLEN] = "unix";
+    if (client_addr.ss_family == AF_INET) {
+        inet_ntop(AF_INET,
+                  &((const struct sockaddr_in *)&client_addr)->sin_addr,
+                  client_ip, sizeof(client_ip));
+    } else if (client_addr.ss_family == AF_INET6) {
+        inet_ntop(AF_INET6,
+                  &((const struct sockaddr_in6 *)&client_addr)->sin6_addr,
+                  client_ip, sizeof(client_ip));
+    }
+    uint32_t sample = control->log_sample.load(std::memory_order_relaxed);
+    if (sample != 0 && worker.accepted++ % sample == 0) {
+        std::cout << "Connection from " << client_ip << std::endl;
+    }
 
-    // Check if the file exists and is readable
-    if (!file_utils::file_exists(full_path)) {
-        std::string not_found = "HTTP/1.1 404 Not Found\r\n"
-                                "Content-Type: text/plain\r\n"
-                                "Content-Length: 9\r\n"
-                                "\r\n"
-                                "Not Found";
-        send(client_socket, not_found.c_str(), not_found.length(), 0);
+    // Per-address and per-prefix connection caps
+    ClientAddress address =
+        client_address_from((const struct sockaddr *)&client_addr);
+    RateLimiter::Admission admission;
+    if (!rate_limiter.admit_connection(address, admission)) {
+        close(client_socket);
         return;
     }
 
+    std::unique_ptr<Connection> conn(new Connection());
+    conn->worker = &worker;
+    conn->fd = client_socket;
+    conn->events = EPOLLIN;
+    conn->output_offset = 0;
+    conn->close_after_write = false;
+    conn->body_remaining = 0;
+    conn->address = address;
+    conn->admission = admission;
+    conn->paced = false;
+
+    struct epoll_event event;
+    event.events = conn->events;
+    event.data.fd = client_socket;
+    if (epoll_ctl(worker.epoll_fd, EPOLL_CTL_ADD, client_socket, &event) <
+        0) {
+        std::cerr << "Failed to watch client socket" << std::endl;
+        rate_limiter.release_connection(address, admission);
+        close(client_socket);
+        return;
+    }
+    worker.connections[client_socket] = std::move(conn);
+    worker.counters->accepted.fetch_add(1, std::memory_order_relaxed);
+}
+
+const StaticFileServer::Listener *
+StaticFileServer::find_listener(const Worker &worker, int fd) const {
+    for (size_t i = 0; i < worker.listeners.size(); ++i) {
+        if (worker.listeners[i]->fd == fd) {
+            return worker.listeners[i];
+        }
+    }
+    return nullptr;
+}
+
+void StaticFileServer::close_connection(Worker &worker, int client_socket) {
+    auto it = worker.connections.find(client_socket);
+    if (it != worker.connections.end()) {
+        rate_limiter.release_connection(it->second->address,
+                                        it->second->admission);
+        worker.counters->closed.fetch_add(1, std::memory_order_relaxed);
+    }
+    epoll_ctl(worker.epoll_fd, EPOLL_CTL_DEL, client_socket, nullptr);
+    close(client_socket);
+    worker.connections.erase(client_socket);
+}
+
+bool StaticFileServer::handle_connection(Connection &conn) {
+    // Read everything the socket has for us, up to the budget; epoll is
+    // level-triggered, so anything left wakes us again next iteration
+    char buffer[READ_BUFFER_SIZE];
+    bool peer_closed = false;
+    size_t start = conn.input.size();
+    {
+        TRACE_SCOPE(READ, conn.fd);
+        while (conn.input.size() - start < config.io_budget) {
+            ssize_t bytes_read = recv(conn.fd, buffer, sizeof(buffer), 0);
+            if (bytes_read > 0) {
+                conn.input.append(buffer, static_cast<size_t>(bytes_read));
+                continue;
+            }
+            if (bytes_read == 0) {
+                peer_closed = true;
+            } else if (errno == EINTR) {
+                continue;
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                std::cerr << "Failed to read from client" << std::endl;
+                return false;
+            }
+            break;
+        }
+    }
+
+    if (conn.input.size() > start) {
+        TRACE_SCOPE(PARSE, conn.fd);
+        if (conn.h2) {
+            if (!conn.h2->receive(conn.input.data(), conn.input.size())) {
+                conn.close_after_write = true;
+            }
+            conn.input.clear();
+        } else if (!handle_http1(conn)) {
+            return false;
+        }
+    }
+
+    if (peer_closed) {
+        // Finish writing whatever the peer already asked for, then close
+        conn.close_after_write = true;
+    }
+    return true;
+}
+
+bool StaticFileServer::handle_http1(Connection &conn) {
+    // HTTP/2 with prior knowledge starts with the connection preface
+    size_t preface_bytes =
+        std::min(conn.input.size(), http2::CONNECTION_PREFACE_LENGTH);
+    if (conn.body_remaining == 0 &&
+        conn.input.compare(0, preface_bytes, http2::CONNECTION_PREFACE,
+                           preface_bytes) == 0) {
+        if (preface_bytes == http2::CONNECTION_PREFACE_LENGTH) {
+            conn.h2.reset(new http2::Session(http2_handler(conn)));
+            if (!conn.h2->receive(conn.input.data(), conn.input.size())) {
+                conn.close_after_write = true;
+            }
+            conn.input.clear();
+        }
+        return true;
+    }
+
+    // Answer every complete request; pipelined responses queue up in order
+    size_t consumed = 0;
+    while (!conn.close_after_write) {
+        // Bodies are never used, but they must not be read as requests
+        size_t skipped =
+            std::min(conn.body_remaining, conn.input.size() - consumed);
+        consumed += skipped;
+        conn.body_remaining -= skipped;
+        if (conn.body_remaining > 0) {
+            break;
+        }
+
+        size_t header_end = conn.input.find("\r\n\r\n", consumed);
+        if (header_end == std::string::npos) {
+            if (conn.input.size() - consumed > MAX_REQUEST_HEAD) {
+                send_response(conn, bad_request, true);
+                conn.close_after_write = true;
+            }
+            break;
+        }
+        std::string request =
+            conn.input.substr(consumed, header_end + 4 - consumed);
+        consumed = header_end + 4;
+
+        HttpRequest parsed = http1::parse_request(request);
+        size_t body_length = 0;
+        if (!http1::body_length(request, body_length)) {
+            send_response(conn, bad_request, true);
+            conn.close_after_write = true;
+            break;
+        }
+
+        // h2c upgrade (RFC 7540 3.2): answer this request as stream 1
+        std::string upgrade = http1::find_header(request, "upgrade");
+        std::string settings = http1::find_header(request, "http2-settings");
+        if (body_length == 0 && upgrade.find("h2c") != std::string::npos &&
+            !settings.empty()) {
+            std::unique_ptr<http2::Session> session(
+                new http2::Session(http2_handler(conn)));
+            if (session->upgrade(settings, parsed)) {
+                Segment switching;
+                switching.owned = "HTTP/1.1 101 Switching Protocols\r\n"
+                                  "Connection: Upgrade\r\n"
+                                  "Upgrade: h2c\r\n"
+                                  "\r\n";
+                conn.output.push_back(std::move(switching));
+                conn.h2 = std::move(session);
+                if (consumed < conn.input.size() &&
+                    !conn.h2->receive(conn.input.data() + consumed,
+                                      conn.input.size() - consumed)) {
+                    conn.close_after_write = true;
+                }
+                conn.input.clear();
+                return true;
+            }
+        }
+
+        bool close =
+            !http1::keep_alive(request) || body_length > MAX_SKIPPED_BODY;
+        send_response(conn, serve_request(conn, parsed), close);
+        conn.close_after_write = close;
+        conn.body_remaining = close ? 0 : body_length;
+    }
+    conn.input.erase(0, consumed);
+    return true;
+}
+
+bool StaticFileServer::flush_connection(Connection &conn) {
+    TRACE_SCOPE(SEND, conn.fd);
+    // Gather queued segments into one sendmsg per round, and stop after
+    // the budget so one busy connection cannot starve the others
+    size_t budget = std::max<size_t>(config.io_budget, 1);
+    size_t written = 0;
+    while (written < budget) {
+        // Frames are produced once earlier bytes are out; this also keeps
+        // a 101 Switching Protocols apart, which some clients require
+        bool refill = conn.h2 && conn.output.empty();
+        while (refill && conn.output.size() < MAX_IOVECS &&
+               conn.h2->has_output()) {
+            Segment frames;
+            conn.h2->produce(frames.owned, WRITE_CHUNK_SIZE);
+            if (frames.owned.empty()) {
+                break;
+            }
+            conn.output.push_back(std::move(frames));
+        }
+        if (conn.output.empty()) {
+            break;
+        }
+
+        struct iovec iov[MAX_IOVECS];
+        size_t count = 0;
+        size_t total = 0;
+        for (auto it = conn.output.begin();
+             it != conn.output.end() && count < MAX_IOVECS &&
+             total < budget - written;
+             ++it) {
+            size_t offset = count == 0 ? conn.output_offset : 0;
+            size_t length =
+                std::min(it->size() - offset, budget - written - total);
+            iov[count].iov_base = const_cast<char *>(it->data() + offset);
+            iov[count].iov_len = length;
+            total += length;
+            ++count;
+        }
+
+        // sendmsg rather than writev, for MSG_NOSIGNAL; a lone segment
+        // (such as one small response) skips the iovec walk
+        ssize_t sent;
+        if (count == 1) {
+            sent = send(conn.fd, iov[0].iov_base, iov[0].iov_len,
+                        MSG_NOSIGNAL);
+        } else {
+            struct msghdr message;
+            memset(&message, 0, sizeof(message));
+            message.msg_iov = iov;
+            message.msg_iovlen = count;
+            sent = sendmsg(conn.fd, &message, MSG_NOSIGNAL);
+        }
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+
+        written += static_cast<size_t>(sent);
+        size_t remaining = static_cast<size_t>(sent);
+        while (remaining > 0) {
+            size_t left = conn.output.front().size() - conn.output_offset;
+            if (remaining < left) {
+                conn.output_offset += remaining;
+                break;
+            }
+            remaining -= left;
+            conn.output.pop_front();
+            conn.output_offset = 0;
+        }
+        if (static_cast<size_t>(sent) < total) {
+            break; // The socket buffer is full
+        }
+    }
+
+    bool pending = !conn.output.empty() || (conn.h2 && conn.h2->has_output());
+    if (!pending && (conn.close_after_write ||
+                     (conn.h2 && conn.h2->is_closed()))) {
+        return false;
+    }
+
+    // Only ask for writability while something is queued, and stop
+    // reading while a pipelining client is far ahead of its responses
+    uint32_t wanted =
+        (conn.output.size() < MAX_QUEUED_SEGMENTS ? EPOLLIN : 0) |
+        (pending ? EPOLLOUT : 0);
+    if (wanted != conn.events) {
+        struct epoll_event event;
+        event.events = wanted;
+        event.data.fd = conn.fd;
+        epoll_ctl(conn.worker->epoll_fd, EPOLL_CTL_MOD, conn.fd, &event);
+        conn.events = wanted;
+    }
+    return true;
+}
+
+http2::RequestHandler StaticFileServer::http2_handler(Connection &conn) {
+    // The session is owned by conn, so conn outlives every call
+    Connection *connection = &conn;
+    return [this, connection](const HttpRequest &request) {
+        return serve_request(*connection, request);
+    };
+}
+
+StaticFileServer::VirtualHost &
+StaticFileServer::select_host(const std::string &host_header) {
+    if (!hosts_by_name.empty() && !host_header.empty()) {
+        auto it = hosts_by_name.find(host_name(host_header));
+        if (it != hosts_by_name.end()) {
+            return *it->second;
+        }
+    }
+    return *hosts[0];
+}
+
+std::shared_ptr<const CachedFile>
+StaticFileServer::error_response(const VirtualHost &host, int status) const {
+    auto it = host.error_pages.find(status);
+    if (it != host.error_pages.end()) {
+        return it->second;
+    }
+    switch (status) {
+    case 400:
+        return bad_request;
+    case 404:
+        return not_found;
+    case 405:
+        return method_not_allowed;
+    case 429:
+        return too_many_requests;
+    default:
+        return server_error;
+    }
+}
+
+std::shared_ptr<const CachedFile>
+StaticFileServer::serve_request(Connection &conn, const HttpRequest &request) {
+    TRACE_SCOPE(LOOKUP, conn.fd);
+    conn.worker->counters->requests.fetch_add(1, std::memory_order_relaxed);
+    VirtualHost &host = select_host(request.host);
+    if (!rate_limiter.allow_request(conn.address)) {
+        return error_response(host, 429);
+    }
+    std::shared_ptr<const CachedFile> response =
+        resolve_request(host, request, conn.worker->replica);
+
+    // Clients over their bandwidth budget are paced by the kernel until
+    // their bucket refills
+    bool within =
+        rate_limiter.charge_bytes(conn.address, response->body.size());
+    if (within == conn.paced) {
+        unsigned int rate =
+            within ? ~0U
+                   : static_cast<unsigned int>(
+                         config.rate_limit.bytes_per_second);
+        setsockopt(conn.fd, SOL_SOCKET, SO_MAX_PACING_RATE, &rate,
+                   sizeof(rate));
+        conn.paced = !within;
+    }
+    return response;
+}
+
+std::shared_ptr<const CachedFile>
+StaticFileServer::resolve_request(VirtualHost &host,
+                                  const HttpRequest &request, size_t replica) {
+    // Only handle GET requests
+    if (request.method != "GET") {
+        return error_response(host, 405);
+    }
+
+    // Canonicalize the path; it is also the key for every lookup below
+    std::string path;
+    if (!file_utils::request_key(request.path, path)) {
+        return error_response(host, 400);
+    }
+
+    std::shared_ptr<const CachedFile> file =
+        load_file(host, path, false, replica);
+    bool gzip = false;
+    if (file->gzip_variant && accepts_gzip(request.accept_encoding)) {
+        std::shared_ptr<const CachedFile> variant =
+            load_file(host, path, true, replica);
+        if (variant->status == 200) {
+            file = variant;
+            gzip = true;
+        }
+    }
+
+    // A client holding the same bytes revalidates with an empty 304
+    if (file->status == 200 && !request.if_none_match.empty() &&
+        etag_matches(request.if_none_match,
+                     content_etag(file->content_hash))) {
+        return not_modified(host, path, *file);
+    }
+
+    // Cache entries count their own hits; count the rest for the hot set
+    if (file->status == 200 &&
+        file->body.size() > config.max_cached_file_size &&
+        !config.hot_set.file.empty()) {
+        std::lock_guard<std::mutex> lock(host.hits_mutex);
+        ++host.uncached_hits[gzip ? "gzip:" + path : path];
+    }
+    return file;
+}
+
+std::shared_ptr<const CachedFile>
+StaticFileServer::load_file(VirtualHost &host, const std::string &path,
+                            bool gzip, size_t replica) {
+    if (host.root_fd < 0) {
+        return error_response(host, 404);
+    }
+    if (shared_cache) {
+        apply_purges();
+    }
+    // Canonical paths start with '/'; keys without one cannot collide
+    std::string key = gzip ? "gzip:" + path : path;
+    std::string relative = path.substr(1) + (gzip ? ".gz" : "");
+    time_t now = time(nullptr);
+
+    // A cached entry is served while the file on disk is unchanged
+    struct stat file_stat;
+    FileCache &cache = *host.caches[replica];
+    std::shared_ptr<const CachedFile> cached = cache.find(key);
+    bool from_shared = false;
+    std::string shared_key;
+    if (shared_cache) {
+        shared_key = host_label(host) + '\n' + key;
+        if (!cached) {
+            // Another worker process may have loaded it already
+            cached = shared_cache->find(shared_key);
+            from_shared = static_cast<bool>(cached);
+        }
+    }
+    if (cached && fstatat(host.root_fd, relative.c_str(), &file_stat, 0) == 0 &&
+        cached->matches(file_stat)) {
+        if (cached->stale_at == 0 || now < cached->stale_at) {
+            if (from_shared) {
+                cache.insert(key, cached); // Skip the shared probe next time
+            }
+            return cached;
+        }
+
+        // Only the time-dependent headers aged: rebuild them around the
+        // same body, without rereading the file or appending a record to
+        // the shared segment
+        std::shared_ptr<CachedFile> refreshed =
+            file_response(host, path, gzip, cached->body, cached->content_hash,
+                          now, stores[replica]->placement());
+        refreshed->device = cached->device;
+        refreshed->inode = cached->inode;
+        refreshed->size = cached->size;
+        refreshed->mtime = cached->mtime;
+        refreshed->gzip_variant = cached->gzip_variant;
+        cache.insert(key, refreshed);
+        return refreshed;
+    }
+
+    // Open relative to the root and only serve regular files
+    int file_fd = file_utils::open_beneath(host.root_fd, relative.c_str());
+    if (file_fd < 0) {
+        return error_response(host, 404);
+    }
+    if (fstat(file_fd, &file_stat) < 0 || !S_ISREG(file_stat.st_mode)) {
+        close(file_fd);
+        return error_response(host, 404);
+    }
+
     // Get the file content
     std::string content;
     try {
-        content = file_utils::read_file(full_path);
+        content = file_utils::read_fd(file_fd,
+                                      static_cast<size_t>(file_stat.st_size));
+        close(file_fd);
     } catch (const std::exception &e) {
-        std::string server_error = "HTTP/1.1 500 Internal Server Error\r\n"
-                                   "Content-Type: text/plain\r\n"
-                                   "Content-Length: 21\r\n"
-                                   "\r\n"
-                                   "Internal Server Error";
-        send(client_socket, server_error.c_str(), server_error.length(), 0);
-        return;
+        close(file_fd);
+        return error_response(host, 500);
     }
 
-    // Send the file with appropriate headers
-    std::string content_type = get_content_type(path);
-    std::string response_header = "HTTP/1.1 200 OK\r\n"
-                                  "Content-Type: " +
-                                  content_type +
-                                  "\r\n"
-                                  "Content-Length: " +
-                                  std::to_string(content.length()) +
-                                  "\r\n"
-                                  "\r\n";
+    // Bodies that will be cached are interned by content hash, so
+    // identical files share one buffer in the huge-page/NUMA pool or heap
+    // (the shared segment deduplicates its own copies instead)
+    uint64_t hash = content_hash(content.data(), content.size());
+    Content body;
+    if (!shared_cache && content.size() <= config.max_cached_file_size) {
+        body = stores[replica]->intern(hash, std::move(content));
+    } else {
+        body = std::move(content);
+    }
+
+    std::shared_ptr<CachedFile> file =
+        file_response(host, path, gzip, std::move(body), hash, now,
+                      stores[replica]->placement());
+    file->device = file_stat.st_dev;
+    file->inode = file_stat.st_ino;
+    file->size = file_stat.st_size;
+    file->mtime = file_stat.st_mtim;
 
-    // Send headers
-    send(client_socket, response_header.c_str(), response_header.length(), 0);
+    // Remember whether a precompressed sibling exists next to the file
+    struct stat gzip_stat;
+    file->gzip_variant =
+        !gzip && host.config.precompressed &&
+        fstatat(host.root_fd, (relative + ".gz").c_str(), &gzip_stat, 0) == 0 &&
+        S_ISREG(gzip_stat.st_mode);
 
-    // Send file content
-    send(client_socket, content.c_str(), content.length(), 0);
+    if (file->body.size() > config.max_cached_file_size) {
+        return file;
+    }
+    std::shared_ptr<const CachedFile> entry = file;
+    if (shared_cache) {
+        // When the segment is full the entry stays process-local
+        std::shared_ptr<const CachedFile> shared =
+            shared_cache->insert(shared_key, *file);
+        if (shared) {
+            entry = shared;
+        }
+    }
+    cache.insert(key, entry);
+    return entry;
+}
+
+std::shared_ptr<CachedFile>
+StaticFileServer::file_response(const VirtualHost &host,
+                                const std::string &path, bool gzip,
+                                Content body, uint64_t hash, time_t now,
+                                ContentPool *pool) {
+    // The ETag depends only on the bytes, so it survives redeploys
+    time_t stale_at = 0;
+    hpack::HeaderList headers = caching_headers(host, path, now, stale_at);
+    headers.push_back(hpack::Header("ETag", content_etag(hash)));
+    if (gzip) {
+        headers.push_back(hpack::Header("Content-Encoding", "gzip"));
+    }
+    std::shared_ptr<CachedFile> file = build_cached_file(
+        200, get_content_type(path), std::move(body), headers, pool);
+    file->stale_at = stale_at;
+    file->content_hash = hash;
+    return file;
+}
+
+hpack::HeaderList
+StaticFileServer::caching_headers(const VirtualHost &host,
+                                  const std::string &path, time_t now,
+                                  time_t &stale_at) const {
+    // Caching headers come from the host's compiled rules
+    hpack::HeaderList headers;
+    const CacheRule *rule = host.policy->match(path);
+    if (rule != nullptr && !rule->cache_control.empty()) {
+        headers.push_back(hpack::Header("Cache-Control", rule->cache_control));
+    }
+    if (rule != nullptr && rule->expires >= 0) {
+        headers.push_back(
+            hpack::Header("Expires", http_date(now + rule->expires)));
+        stale_at = now + HEADER_REFRESH_SECONDS;
+    }
+    if (host.config.precompressed) {
+        headers.push_back(hpack::Header("Vary", "Accept-Encoding"));
+    }
+    return headers;
+}
+
+std::shared_ptr<const CachedFile>
+StaticFileServer::not_modified(const VirtualHost &host,
+                               const std::string &path,
+                               const CachedFile &file) const {
+    // Carries the headers a 200 would, minus the representation ones
+    time_t stale_at = 0;
+    hpack::HeaderList headers =
+        caching_headers(host, path, time(nullptr), stale_at);
+    headers.push_back(hpack::Header("ETag", content_etag(file.content_hash)));
+    return build_cached_file(304, "", "", headers);
+}
+
+void StaticFileServer::send_response(
+    Connection &conn, const std::shared_ptr<const CachedFile> &response,
+    bool close) {
+    // Small responses go out as one preformatted buffer
+    if (!close && !response->packet.empty()) {
+        Segment packet;
+        packet.response = response;
+        packet.view = response->packet.data();
+        packet.length = response->packet.size();
+        conn.output.push_back(std::move(packet));
+        return;
+    }
+
+    // Otherwise headers are preformatted and the body is sent straight
+    // from the entry; both are queued as views of it
+    const std::string &header = response->http1_header;
+    Segment head;
+    head.response = response;
+    head.view = header.data();
+    head.length = header.size();
+    if (close) {
+        head.length -= 2; // Reopen the header block before its final CRLF
+    }
+    conn.output.push_back(std::move(head));
+    if (close) {
+        Segment connection;
+        connection.owned = "Connection: close\r\n\r\n";
+        conn.output.push_back(std::move(connection));
+    }
+    if (!response->body.empty()) {
+        Segment body;
+        body.response = response;
+        body.view = response->body.data();
+        body.length = response->body.size();
+        conn.output.push_back(std::move(body));
+    }
 }
 
 std::string StaticFileServer::get_content_type(const std::string &path) {
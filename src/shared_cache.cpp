@@ -0,0 +1,304 @@
+#include "../include/shared_cache.h"
+#include "../include/content_store.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+const uint64_t MAGIC = 0x5353484341434831ULL; // "SSHCACH1"
+const size_t PROBE_LIMIT = 32;
+const size_t RECORD_ALIGNMENT = 64;
+const size_t BYTES_PER_SLOT = 16 * 1024; // Expected average record size
+
+uint64_t hash_key(const std::string &key) {
+    // FNV-1a; 0 marks a free slot, so it is never returned
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < key.size(); ++i) {
+        hash ^= static_cast<unsigned char>(key[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash | 1;
+}
+
+size_t align(size_t value) {
+    return (value + RECORD_ALIGNMENT - 1) / RECORD_ALIGNMENT *
+           RECORD_ALIGNMENT;
+}
+} // namespace
+
+struct SharedCache::Header {
+    uint64_t magic;
+    uint64_t slot_count;
+    uint64_t data_start;
+    std::atomic<uint64_t> next; // Bump offset of the next record
+};
+
+// Fixed part of a record; key, content type, HPACK and HTTP/1.1 headers
+// follow it. The body comes next, on a cache line boundary unless it is
+// small enough to follow the HTTP/1.1 header as its packet, and not at all
+// when the record reuses an identical body stored by an earlier one.
+struct SharedCache::Record {
+    uint32_t key_length;
+    uint32_t content_type_length;
+    uint32_t http1_length;
+    uint32_t hpack_length;
+    uint64_t body_length;
+    uint64_t body_offset; // From the segment start
+    uint64_t content_hash;
+    int32_t status;
+    uint32_t gzip_variant;
+    uint64_t device;
+    uint64_t inode;
+    int64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    int64_t stale_at;
+};
+
+SharedCache::SharedCache(size_t bytes, bool huge_pages)
+    : size(bytes), header(nullptr), slots(nullptr) {
+    int fd = -1;
+    if (huge_pages) {
+        fd = memfd_create("static_server_cache", MFD_CLOEXEC | MFD_HUGETLB);
+        if (fd >= 0 && ftruncate(fd, static_cast<off_t>(bytes)) < 0) {
+            close(fd); // No reserved huge pages; use normal ones
+            fd = -1;
+        }
+    }
+    if (fd < 0) {
+        fd = memfd_create("static_server_cache", MFD_CLOEXEC);
+        if (fd < 0 || ftruncate(fd, static_cast<off_t>(bytes)) < 0) {
+            if (fd >= 0) {
+                close(fd);
+            }
+            throw std::runtime_error("Failed to create shared cache segment");
+        }
+    }
+    void *base =
+        mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // The mapping keeps the memory alive
+    if (base == MAP_FAILED) {
+        throw std::runtime_error("Failed to map shared cache segment");
+    }
+    mapping.reset(static_cast<char *>(base),
+                  [bytes](char *p) { munmap(p, bytes); });
+
+    // A fresh memfd is zeroed, so every slot starts free
+    header = new (base) Header();
+    header->magic = MAGIC;
+    header->slot_count = std::max<uint64_t>(bytes / BYTES_PER_SLOT, 64);
+    slots = reinterpret_cast<Slot *>(mapping.get() + align(sizeof(Header)));
+    header->data_start =
+        align(align(sizeof(Header)) + header->slot_count * sizeof(Slot));
+    if (header->data_start >= bytes) {
+        throw std::runtime_error("Shared cache segment is too small");
+    }
+    header->next.store(header->data_start);
+}
+
+size_t SharedCache::erase(const std::string &key, bool prefix) {
+    // A zero offset reads as "not published", and publish() may reuse
+    // the slot for the same key later
+    size_t erased = 0;
+    for (uint64_t i = 0; i < header->slot_count; ++i) {
+        Slot &slot = slots[i];
+        uint64_t offset = slot.offset.load(std::memory_order_acquire);
+        if (offset == 0) {
+            continue;
+        }
+        const Record *record = record_at(offset);
+        const char *record_key = reinterpret_cast<const char *>(record + 1);
+        bool match =
+            prefix ? record->key_length >= key.size() &&
+                         memcmp(record_key, key.data(), key.size()) == 0
+                   : key_matches(offset, key);
+        if (match && slot.offset.compare_exchange_strong(offset, 0)) {
+            ++erased;
+        }
+    }
+    return erased;
+}
+
+size_t SharedCache::used_bytes() const {
+    return static_cast<size_t>(
+        std::min<uint64_t>(header->next.load(std::memory_order_relaxed),
+                           size));
+}
+
+size_t SharedCache::capacity() const { return size; }
+
+const SharedCache::Record *SharedCache::record_at(uint64_t offset) const {
+    return reinterpret_cast<const Record *>(mapping.get() + offset);
+}
+
+bool SharedCache::key_matches(uint64_t offset, const std::string &key) const {
+    const Record *record = record_at(offset);
+    return record->key_length == key.size() &&
+           memcmp(record + 1, key.data(), key.size()) == 0;
+}
+
+uint64_t SharedCache::lookup(const std::string &key, bool verify) const {
+    uint64_t hash = hash_key(key);
+    for (size_t i = 0; i < PROBE_LIMIT; ++i) {
+        const Slot &slot = slots[(hash + i) % header->slot_count];
+        uint64_t slot_hash = slot.hash.load(std::memory_order_acquire);
+        if (slot_hash == 0) {
+            break;
+        }
+        if (slot_hash != hash) {
+            continue;
+        }
+        uint64_t offset = slot.offset.load(std::memory_order_acquire);
+        if (offset != 0 && (!verify || key_matches(offset, key))) {
+            return offset;
+        }
+    }
+    return 0;
+}
+
+bool SharedCache::publish(const std::string &key, uint64_t offset,
+                          bool verify) {
+    // Claim a free slot or replace this key's previous record
+    uint64_t hash = hash_key(key);
+    for (size_t i = 0; i < PROBE_LIMIT; ++i) {
+        Slot &slot = slots[(hash + i) % header->slot_count];
+        uint64_t slot_hash = slot.hash.load(std::memory_order_acquire);
+        if (slot_hash == 0 &&
+            slot.hash.compare_exchange_strong(slot_hash, hash)) {
+            slot.offset.store(offset, std::memory_order_release);
+            return true;
+        }
+        if (slot_hash != hash) {
+            continue;
+        }
+        uint64_t previous = slot.offset.load(std::memory_order_acquire);
+        if (previous == 0 || !verify || key_matches(previous, key)) {
+            slot.offset.store(offset, std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<const CachedFile>
+SharedCache::find(const std::string &key) const {
+    uint64_t offset = lookup(key, true);
+    if (offset == 0) {
+        return std::shared_ptr<const CachedFile>();
+    }
+    return materialize(offset);
+}
+
+std::shared_ptr<const CachedFile>
+SharedCache::insert(const std::string &key, const CachedFile &file) {
+    // Bodies are indexed by content hash under a key no request can
+    // produce. It names a record holding the body, whose own key differs,
+    // so slots match on hash alone and the bytes are compared instead.
+    std::string body_key;
+    uint64_t body_at = 0;
+    if (file.content_hash != 0 && !file.body.empty()) {
+        body_key = std::string(1, '\0') + content_etag(file.content_hash);
+        uint64_t owner = lookup(body_key, false);
+        if (owner != 0) {
+            const Record *existing = record_at(owner);
+            if (existing->body_length == file.body.size() &&
+                memcmp(mapping.get() + existing->body_offset,
+                       file.body.data(), file.body.size()) == 0) {
+                body_at = existing->body_offset;
+            }
+        }
+    }
+
+    // Lay out and claim space for the record
+    size_t prefix = sizeof(Record) + key.size() + file.content_type.size() +
+                    file.http1_header.size() + file.hpack_header.size();
+    size_t body_start = align(prefix);
+    size_t total = body_start;
+    if (body_at == 0) {
+        if (file.body.size() <= PACKET_BODY_LIMIT) {
+            body_start = prefix; // Right after the HTTP/1.1 header
+        }
+        total = align(body_start + file.body.size());
+    }
+    uint64_t offset = header->next.fetch_add(total);
+    if (offset + total > size) {
+        return std::shared_ptr<const CachedFile>(); // Segment is full
+    }
+    if (body_at == 0) {
+        body_at = offset + body_start;
+        memcpy(mapping.get() + body_at, file.body.data(), file.body.size());
+    }
+
+    char *base = mapping.get() + offset;
+    Record *record = reinterpret_cast<Record *>(base);
+    record->key_length = static_cast<uint32_t>(key.size());
+    record->content_type_length =
+        static_cast<uint32_t>(file.content_type.size());
+    record->http1_length = static_cast<uint32_t>(file.http1_header.size());
+    record->hpack_length = static_cast<uint32_t>(file.hpack_header.size());
+    record->body_length = file.body.size();
+    record->body_offset = body_at;
+    record->content_hash = file.content_hash;
+    record->status = file.status;
+    record->gzip_variant = file.gzip_variant ? 1 : 0;
+    record->device = file.device;
+    record->inode = file.inode;
+    record->size = file.size;
+    record->mtime_sec = file.mtime.tv_sec;
+    record->mtime_nsec = file.mtime.tv_nsec;
+    record->stale_at = file.stale_at;
+    char *cursor = base + sizeof(Record);
+    const std::string *parts[] = {&key, &file.content_type, &file.hpack_header,
+                                  &file.http1_header};
+    for (size_t i = 0; i < 4; ++i) {
+        memcpy(cursor, parts[i]->data(), parts[i]->size());
+        cursor += parts[i]->size();
+    }
+
+    if (!publish(key, offset, true)) {
+        return std::shared_ptr<const CachedFile>();
+    }
+    if (!body_key.empty() && body_at == offset + body_start) {
+        publish(body_key, offset, false); // Later copies reuse this body
+    }
+    return materialize(offset);
+}
+
+std::shared_ptr<const CachedFile>
+SharedCache::materialize(uint64_t offset) const {
+    const Record *record = record_at(offset);
+    const char *cursor = reinterpret_cast<const char *>(record + 1) +
+                         record->key_length;
+
+    // Headers are copied out (they are small); the body stays shared
+    std::shared_ptr<CachedFile> file(new CachedFile());
+    file->status = record->status;
+    file->content_type.assign(cursor, record->content_type_length);
+    cursor += record->content_type_length;
+    file->hpack_header.assign(cursor, record->hpack_length);
+    cursor += record->hpack_length;
+    file->http1_header.assign(cursor, record->http1_length);
+    const char *body = mapping.get() + record->body_offset;
+    file->body = Content(std::shared_ptr<const char>(mapping, body),
+                         static_cast<size_t>(record->body_length));
+    if (!file->body.empty() && file->body.size() <= PACKET_BODY_LIMIT &&
+        body == cursor + record->http1_length) {
+        file->packet =
+            Content(std::shared_ptr<const char>(mapping, cursor),
+                    record->http1_length + file->body.size());
+    } else {
+        prepare_packet(*file); // A reused body sits after another header
+    }
+    file->device = static_cast<dev_t>(record->device);
+    file->inode = static_cast<ino_t>(record->inode);
+    file->size = static_cast<off_t>(record->size);
+    file->mtime.tv_sec = static_cast<time_t>(record->mtime_sec);
+    file->mtime.tv_nsec = static_cast<long>(record->mtime_nsec);
+    file->stale_at = static_cast<time_t>(record->stale_at);
+    file->gzip_variant = record->gzip_variant != 0;
+    file->content_hash = record->content_hash;
+    return file;
+}
@@ -0,0 +1,102 @@
+#include "../include/topology.h"
+#include <cstdlib>
+#include <fstream>
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace topology {
+namespace {
+std::string read_line(const std::string &path) {
+    std::ifstream in(path.c_str());
+    std::string line;
+    std::getline(in, line);
+    return line;
+}
+} // namespace
+
+std::vector<int> parse_list(const std::string &list) {
+    std::vector<int> values;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t end = list.find(',', pos);
+        if (end == std::string::npos) {
+            end = list.size();
+        }
+        std::string range = list.substr(pos, end - pos);
+        size_t dash = range.find('-');
+        if (!range.empty() && range.find_first_not_of("0123456789-") ==
+                                  std::string::npos) {
+            int first = atoi(range.c_str());
+            int last = dash == std::string::npos
+                           ? first
+                           : atoi(range.c_str() + dash + 1);
+            for (int value = first; value <= last; ++value) {
+                values.push_back(value);
+            }
+        }
+        pos = end + 1;
+    }
+    return values;
+}
+
+std::vector<int> memory_nodes() {
+    std::vector<int> nodes =
+        parse_list(read_line("/sys/devices/system/node/has_memory"));
+    if (nodes.empty()) {
+        nodes.push_back(0);
+    }
+    return nodes;
+}
+
+std::vector<int> node_cpus(int node) {
+    return parse_list(read_line("/sys/devices/system/node/node" +
+                                std::to_string(node) + "/cpulist"));
+}
+
+std::vector<int> online_cpus() {
+    std::vector<int> cpus =
+        parse_list(read_line("/sys/devices/system/cpu/online"));
+    if (cpus.empty()) {
+        cpus.push_back(0);
+    }
+    return cpus;
+}
+
+bool bind_cpu(int cpu) {
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+bool bind_thread(int node) {
+    bool bound = false;
+    std::vector<int> cpus = node_cpus(node);
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (size_t i = 0; i < cpus.size(); ++i) {
+            if (cpus[i] < CPU_SETSIZE) {
+                CPU_SET(cpus[i], &set);
+            }
+        }
+        bound = sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+
+    // Preferred rather than bound, so a full node still falls back
+    unsigned long mask[16] = {0};
+    if (node < 0 || node >= static_cast<int>(sizeof(mask) * 8)) {
+        return false;
+    }
+    mask[node / (sizeof(unsigned long) * 8)] |=
+        1UL << (node % (sizeof(unsigned long) * 8));
+    bool preferred = syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask,
+                             sizeof(mask) * 8) == 0;
+    return bound && preferred;
+}
+} // namespace topology
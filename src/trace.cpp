@@ -0,0 +1,148 @@
+#include "../include/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+#endif
+
+namespace trace {
+namespace {
+const size_t RING_SIZE = 1 << 16; // Events kept per thread
+
+struct Event {
+    uint64_t start;
+    uint64_t end;
+    int32_t fd;
+    uint32_t phase;
+};
+
+// Written only by its thread; dumps read it without stopping the writer,
+// so an event being overwritten at that moment may come out torn
+struct Ring {
+    Event events[RING_SIZE];
+    std::atomic<uint64_t> head; // Events ever recorded
+    long tid;
+};
+
+std::mutex rings_mutex;
+std::vector<Ring *> rings; // Never freed; a dump may outlive its thread
+
+Ring *local_ring() {
+    static thread_local Ring *ring = nullptr;
+    if (ring == nullptr) {
+        ring = new Ring();
+        ring->head.store(0);
+        ring->tid = syscall(SYS_gettid);
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        rings.push_back(ring);
+    }
+    return ring;
+}
+
+// Timestamp ticks per microsecond, measured once against the clock
+double ticks_per_us() {
+    static double ratio = 0;
+    static std::once_flag once;
+    std::call_once(once, []() {
+        uint64_t ticks = now();
+        uint64_t ns = monotonic_ns();
+        struct timespec pause = {0, 10 * 1000 * 1000};
+        nanosleep(&pause, nullptr);
+        ratio = static_cast<double>(now() - ticks) * 1000.0 /
+                static_cast<double>(monotonic_ns() - ns);
+        if (ratio <= 0) {
+            ratio = 1;
+        }
+    });
+    return ratio;
+}
+} // namespace
+
+const char *phase_name(Phase phase) {
+    static const char *NAMES[PHASE_COUNT] = {"accept", "read", "parse",
+                                             "lookup", "send"};
+    return phase < PHASE_COUNT ? NAMES[phase] : "unknown";
+}
+
+uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+void record(Phase phase, int fd, uint64_t start, uint64_t end) {
+#ifdef HAVE_SYS_SDT_H
+    DTRACE_PROBE3(static_server, phase, static_cast<int>(phase), fd,
+                  end - start);
+#endif
+    Ring *ring = local_ring();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    Event &event = ring->events[head % RING_SIZE];
+    event.start = start;
+    event.end = end;
+    event.fd = fd;
+    event.phase = static_cast<uint32_t>(phase);
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+std::string dump_json() {
+    std::vector<Ring *> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        snapshot = rings;
+    }
+
+    // Timestamps are shown relative to the oldest event kept
+    struct Row {
+        Event event;
+        long tid;
+    };
+    std::vector<Row> rows;
+    for (size_t r = 0; r < snapshot.size(); ++r) {
+        uint64_t head = snapshot[r]->head.load(std::memory_order_acquire);
+        uint64_t count = std::min<uint64_t>(head, RING_SIZE);
+        for (uint64_t i = head - count; i < head; ++i) {
+            Row row;
+            row.event = snapshot[r]->events[i % RING_SIZE];
+            row.tid = snapshot[r]->tid;
+            rows.push_back(row);
+        }
+    }
+    uint64_t base = UINT64_MAX;
+    for (size_t i = 0; i < rows.size(); ++i) {
+        base = std::min(base, rows[i].event.start);
+    }
+
+    double ratio = ticks_per_us();
+    std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    char line[256];
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const Event &event = rows[i].event;
+        snprintf(line, sizeof(line),
+                 "%s\n{\"name\":\"%s\",\"cat\":\"request\",\"ph\":\"X\","
+                 "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%ld,"
+                 "\"args\":{\"fd\":%d}}",
+                 i == 0 ? "" : ",",
+                 phase_name(static_cast<Phase>(event.phase)),
+                 (event.start - base) / ratio,
+                 (event.end - event.start) / ratio, static_cast<int>(getpid()),
+                 rows[i].tid, event.fd);
+        json += line;
+    }
+    json += "\n]}\n";
+    return json;
+}
+
+bool write_json(const std::string &path) {
+    std::ofstream out(path.c_str(), std::ios::trunc);
+    out << dump_json();
+    return static_cast<bool>(out);
+}
+} // namespace trace
@@ -0,0 +1,174 @@
+#include "../include/admin.h"
+#include "../include/config.h"
+#include "../include/server.h"
+#include "test_utils.hpp"
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+const std::string TEST_DIR = "./test_admin_public";
+const std::string SOCKET_PATH = "./test_admin.sock";
+
+int connect_unix(const std::string &path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    struct timeval timeout;
+    timeout.tv_sec = 3;
+    timeout.tv_usec = 0;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+// Sends one command and reads its reply through the OK/ERROR line
+std::string command(int fd, const std::string &line) {
+    std::string request = line + "\n";
+    if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) < 0) {
+        return "";
+    }
+    std::string reply;
+    char buffer[1024];
+    while (reply.find("OK\n") == std::string::npos &&
+           reply.find("ERROR") == std::string::npos) {
+        ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+            break;
+        }
+        reply.append(buffer, received);
+    }
+    return reply;
+}
+
+bool contains(const std::string &text, const std::string &part) {
+    return text.find(part) != std::string::npos;
+}
+} // namespace
+
+// Test that command lines split into words on any run of blanks
+void test_split() {
+    std::vector<std::string> words = admin::split("  purge\tdocs  /a* \r");
+    test_utils::test_assert(words.size() == 3 && words[0] == "purge" &&
+                                words[1] == "docs" && words[2] == "/a*",
+                            "Words should be split on spaces and tabs");
+    test_utils::test_assert(admin::split(" \t ").empty(),
+                            "A blank line should have no words");
+}
+
+// Test that the control block starts zeroed and is shared with children
+void test_control_block() {
+    admin::Control *control = admin::map_control();
+    test_utils::test_assert(control->purge_generation.load() == 0 &&
+                                control->counters[0].requests.load() == 0,
+                            "The control block should start zeroed");
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        control->counters[1].requests.fetch_add(5);
+        _exit(0);
+    }
+    waitpid(pid, nullptr, 0);
+    bool shared = control->counters[1].requests.load() == 5;
+    admin::unmap_control(control);
+    test_utils::test_assert(shared, "A child's counts should be visible");
+}
+
+// Test that the socket is created owner-only and bad paths are refused
+void test_open_socket() {
+    int fd = admin::open_socket(SOCKET_PATH);
+    struct stat info;
+    bool owner_only = stat(SOCKET_PATH.c_str(), &info) == 0 &&
+                      (info.st_mode & 077) == 0;
+    close(fd);
+
+    // A leftover socket file from a previous run is replaced
+    fd = admin::open_socket(SOCKET_PATH);
+    close(fd);
+    unlink(SOCKET_PATH.c_str());
+    test_utils::test_assert(owner_only, "The socket should be owner-only");
+
+    bool rejected = false;
+    try {
+        admin::open_socket(std::string(200, 'x'));
+    } catch (const std::runtime_error &) {
+        rejected = true;
+    }
+    test_utils::test_assert(rejected, "Overlong paths should be rejected");
+}
+
+// Test stats, purge, warm and log against a running server
+void test_commands() {
+    test_utils::ensure_directory(TEST_DIR);
+    test_utils::create_test_file(TEST_DIR + "/a.txt", "alpha");
+    test_utils::create_test_file(TEST_DIR + "/b.txt", "beta");
+
+    ServerConfig config;
+    config.port = 0;
+    config.root_directory = TEST_DIR;
+    config.admin_socket = SOCKET_PATH;
+    config.workers = 1;
+    StaticFileServer server(config);
+    std::thread server_thread([&server]() {
+        try {
+            server.start();
+        } catch (const std::exception &e) {
+            std::cerr << "Server error: " << e.what() << std::endl;
+        }
+    });
+
+    int fd = connect_unix(SOCKET_PATH);
+    std::string stats, warm, purge, after, log, bad;
+    if (fd >= 0) {
+        warm = command(fd, "warm /a.txt /b.txt /missing.txt");
+        stats = command(fd, "stats");
+        purge = command(fd, "purge * /a*");
+        after = command(fd, "stats");
+        log = command(fd, "log 0");
+        bad = command(fd, "purge nosuchhost /a.txt");
+        command(fd, "quit");
+        close(fd);
+    }
+
+    server.stop();
+    server_thread.join();
+    test_utils::cleanup_test_file(TEST_DIR + "/a.txt");
+    test_utils::cleanup_test_file(TEST_DIR + "/b.txt");
+    rmdir(TEST_DIR.c_str());
+
+    test_utils::test_assert(fd >= 0, "The admin socket should accept");
+    test_utils::test_assert(contains(warm, "warmed 2 missing 1\nOK\n"),
+                            "Warm should load existing files");
+    test_utils::test_assert(contains(stats, "host * entries 2 bytes 9\n"),
+                            "Stats should report the cache contents");
+    test_utils::test_assert(contains(purge, "purged 1\nOK\n") &&
+                                contains(after, "entries 1 bytes 4\n"),
+                            "Purging a prefix should drop matching entries");
+    test_utils::test_assert(contains(log, "log_sample 0\nOK\n"),
+                            "Log should set the sampling rate");
+    test_utils::test_assert(contains(bad, "ERROR unknown host"),
+                            "Unknown hosts should be reported");
+}
+
+int main() {
+    std::cout << "===== Running Admin Tests =====" << std::endl;
+
+    test_utils::run_test("Split", test_split);
+    test_utils::run_test("Control Block", test_control_block);
+    test_utils::run_test("Open Socket", test_open_socket);
+    test_utils::run_test("Commands", test_commands);
+
+    test_utils::print_test_summary();
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "../include/cache_policy.h"
+#include "test_utils.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+static CacheRule rule(const std::string &pattern, const std::string &value) {
+    CacheRule result;
+    result.pattern = pattern;
+    result.cache_control = value;
+    return result;
+}
+
+static std::string matched(const CachePolicy &policy, const std::string &path) {
+    const CacheRule *found = policy.match(path);
+    return found != nullptr ? found->cache_control : "";
+}
+
+// Test exact, prefix and extension patterns on their own
+void test_pattern_kinds() {
+    std::vector<CacheRule> rules;
+    rules.push_back(rule("/favicon.ico", "exact"));
+    rules.push_back(rule("/assets/*", "prefix"));
+    rules.push_back(rule("*.css", "extension"));
+    CachePolicy policy(rules);
+
+    test_utils::test_assert(matched(policy, "/favicon.ico") == "exact",
+                            "Exact patterns should match their path");
+    test_utils::test_assert(matched(policy, "/favicon.ico2") == "",
+                            "Exact patterns should not match longer paths");
+    test_utils::test_assert(matched(policy, "/assets/app.js") == "prefix",
+                            "Prefix patterns should match below the prefix");
+    test_utils::test_assert(matched(policy, "/assets") == "",
+                            "Prefix patterns need the trailing slash");
+    test_utils::test_assert(matched(policy, "/style.css") == "extension",
+                            "Extension patterns should match the suffix");
+    test_utils::test_assert(matched(policy, "/style.css.map") == "",
+                            "Only the last extension should count");
+    test_utils::test_assert(matched(policy, "/index.html") == "",
+                            "Unmatched paths should have no rule");
+}
+
+// Test that exact beats the longest prefix, which beats an extension
+void test_precedence() {
+    std::vector<CacheRule> rules;
+    rules.push_back(rule("*.css", "extension"));
+    rules.push_back(rule("/static/*", "short"));
+    rules.push_back(rule("/static/v2/*", "long"));
+    rules.push_back(rule("/static/v2/main.css", "exact"));
+    CachePolicy policy(rules);
+
+    test_utils::test_assert(matched(policy, "/static/v2/main.css") == "exact",
+                            "Exact should win over prefixes and extensions");
+    test_utils::test_assert(matched(policy, "/static/v2/other.css") == "long",
+                            "The longest prefix should win");
+    test_utils::test_assert(matched(policy, "/static/v1/a.css") == "short",
+                            "A prefix should win over an extension");
+    test_utils::test_assert(matched(policy, "/root.css") == "extension",
+                            "Extensions apply outside every prefix");
+}
+
+// Test that unsupported patterns are rejected up front
+void test_invalid_patterns() {
+    const char *invalid[] = {"", "assets/*", "/a/*/b", "*", "*.", "/a*"};
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i) {
+        std::vector<CacheRule> rules;
+        rules.push_back(rule(invalid[i], "x"));
+        bool threw = false;
+        try {
+            CachePolicy policy(rules);
+        } catch (const std::runtime_error &) {
+            threw = true;
+        }
+        test_utils::test_assert(threw, std::string("Pattern should be "
+                                                   "rejected: ") +
+                                           invalid[i]);
+    }
+}
+
+int main() {
+    std::cout << "===== Running CachePolicy Tests =====" << std::endl;
+
+    test_utils::run_test("Pattern Kinds", test_pattern_kinds);
+    test_utils::run_test("Rule Precedence", test_precedence);
+    test_utils::run_test("Invalid Patterns", test_invalid_patterns);
+
+    test_utils::print_test_summary();
+
+    return 0;
+}
@@ -9,6 +9,10 @@ void test_default_config() {
     test_utils::test_assert(config.port == 8080, "Default port should be 8080");
     test_utils::test_assert(config.root_directory == "./public",
                             "Default root directory should be ./public");
+    test_utils::test_assert(config.cache_size == 64 * 1024 * 1024,
+                            "Default cache size should be 64MB");
+    test_utils::test_assert(config.max_cached_file_size == 1024 * 1024,
+                            "Default cached file limit should be 1MB");
 }
 
 // Test custom configuration values
@@ -41,12 +45,29 @@ void test_config_edge_cases() {
                             "Root directory should allow empty string");
 }
 
+// Test listener defaults
+void test_listener_defaults() {
+    ServerConfig config;
+    test_utils::test_assert(config.listeners.empty(),
+                            "No explicit listeners by default");
+
+    ListenerConfig listener;
+    test_utils::test_assert(listener.address == "0.0.0.0",
+                            "Listeners should default to all IPv4 addresses");
+    test_utils::test_assert(listener.backlog == 128,
+                            "Default backlog should be 128");
+    test_utils::test_assert(listener.nodelay && listener.defer_accept == 0 &&
+                                listener.fastopen == 0,
+                            "Only TCP_NODELAY should be on by default");
+}
+
 int main() {
     std::cout << "===== Running ServerConfig Tests =====" << std::endl;
 
     test_utils::run_test("Default Configuration", test_default_config);
     test_utils::run_test("Custom Configuration", test_custom_config);
     test_utils::run_test("Configuration Edge Cases", test_config_edge_cases);
+    test_utils::run_test("Listener Defaults", test_listener_defaults);
 
     test_utils::print_test_summary();
 
@@ -0,0 +1,194 @@
+#include "../include/config_file.h"
+#include "test_utils.hpp"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+static bool rejects(const std::string &text) {
+    try {
+        parse_config(text);
+    } catch (const std::runtime_error &) {
+        return true;
+    }
+    return false;
+}
+
+// Test that every section lands in ServerConfig
+void test_parse_full_config() {
+    ServerConfig config = parse_config(
+        "{\n"
+        "  \"root\": \"/srv/default\",\n"
+        "  \"cache_size\": 1048576,\n"
+        "  \"listen\": [{\"address\": \"::1\", \"port\": 8443,\n"
+        "              \"v6_only\": true, \"reuseport\": \"cpu\"}],\n"
+        "  \"rate_limit\": {\"requests_per_second\": 20},\n"
+        "  \"compression\": \"precompressed\",\n"
+        "  \"workers\": 8,\n"
+        "  \"processes\": 4,\n"
+        "  \"io_budget\": 65536,\n"
+        "  \"admin_socket\": \"/run/static.sock\",\n"
+        "  \"log_sample\": 100,\n"
+        "  \"shared_cache_size\": 33554432,\n"
+        "  \"memory\": {\"huge_pages\": true, \"numa\": \"replicate\"},\n"
+        "  \"hot_set\": {\"file\": \"/var/lib/hot\", \"interval\": 30},\n"
+        "  \"error_pages\": {\"404\": \"/errors/404.html\"},\n"
+        "  \"cache_rules\": [{\"match\": \"*.css\",\n"
+        "                   \"cache_control\": \"max-age=60\",\n"
+        "                   \"expires\": 60}],\n"
+        "  \"virtual_hosts\": [{\"server_names\": [\"a.test\", \"b.test\"],\n"
+        "                     \"root\": \"/srv/a\",\n"
+        "                     \"cache_size\": 2048}]\n"
+        "}\n");
+
+    test_utils::test_assert(config.root_directory == "/srv/default",
+                            "root should set the default root");
+    test_utils::test_assert(config.cache_size == 1048576,
+                            "cache_size should be parsed");
+    test_utils::test_assert(config.listeners.size() == 1 &&
+                                config.listeners[0].address == "::1" &&
+                                config.listeners[0].port == 8443 &&
+                                config.listeners[0].v6_only &&
+                                config.listeners[0].reuseport == "cpu",
+                            "Listeners should be parsed");
+    test_utils::test_assert(config.rate_limit.requests_per_second == 20,
+                            "Rate limits should be parsed");
+    test_utils::test_assert(config.hot_set.file == "/var/lib/hot" &&
+                                config.hot_set.interval == 30 &&
+                                config.hot_set.max_entries == 1024,
+                            "Hot-set settings should be parsed");
+    test_utils::test_assert(config.workers == 8 && config.memory.huge_pages &&
+                                config.memory.numa == "replicate",
+                            "Worker and memory settings should be parsed");
+    test_utils::test_assert(config.processes == 4 &&
+                                config.shared_cache_size == 33554432 &&
+                                config.io_budget == 65536,
+                            "Process and I/O settings should be parsed");
+    test_utils::test_assert(config.admin_socket == "/run/static.sock" &&
+                                config.log_sample == 100,
+                            "Admin settings should be parsed");
+    test_utils::test_assert(config.precompressed,
+                            "compression should enable .gz variants");
+    test_utils::test_assert(config.error_pages[404] == "/errors/404.html",
+                            "Error pages should be keyed by status");
+    test_utils::test_assert(config.cache_rules.size() == 1 &&
+                                config.cache_rules[0].pattern == "*.css" &&
+                                config.cache_rules[0].expires == 60,
+                            "Cache rules should be parsed");
+    test_utils::test_assert(config.virtual_hosts.size() == 1 &&
+                                config.virtual_hosts[0].server_names.size() ==
+                                    2 &&
+                                config.virtual_hosts[0].cache_size == 2048,
+                            "Virtual hosts should be parsed");
+    test_utils::test_assert(!config.virtual_hosts[0].precompressed,
+                            "Virtual hosts should not inherit compression");
+}
+
+// Test that mistakes are reported instead of ignored
+void test_parse_errors() {
+    test_utils::test_assert(parse_config("{}").port == 8080,
+                            "An empty object should keep the defaults");
+    test_utils::test_assert(rejects("{\"prot\": 80}"),
+                            "Unknown keys should be rejected");
+    test_utils::test_assert(rejects("{\"port\": \"80\"}"),
+                            "Values of the wrong type should be rejected");
+    test_utils::test_assert(rejects("{\"port\": 80,}"),
+                            "Trailing commas should be rejected");
+    test_utils::test_assert(rejects("{\"memory\": {\"numa\": \"on\"}}"),
+                            "Unknown NUMA modes should be rejected");
+    test_utils::test_assert(rejects("{\"compression\": \"brotli\"}"),
+                            "Unknown compression modes should be rejected");
+    test_utils::test_assert(
+        rejects("{\"listen\": [{\"reuseport\": \"rss\"}]}"),
+        "Unknown reuseport modes should be rejected");
+    test_utils::test_assert(
+        rejects("{\"virtual_hosts\": [{\"root\": \"/srv\"}]}"),
+        "Virtual hosts without names should be rejected");
+    test_utils::test_assert(rejects("{\"error_pages\": {\"abc\": \"/x\"}}"),
+                            "Error page keys must be status codes");
+    test_utils::test_assert(
+        rejects("{\"error_pages\": {\"404abc\": \"/x\"}}"),
+        "Error page keys must be nothing but a status code");
+}
+
+// Test that numbers are checked against the field they set
+void test_parse_numbers() {
+    test_utils::test_assert(rejects("{\"workers\": -1}"),
+                            "Negative counts should be rejected");
+    test_utils::test_assert(rejects("{\"cache_size\": 1e300}"),
+                            "Sizes out of range should be rejected");
+    test_utils::test_assert(rejects("{\"processes\": 2.5}"),
+                            "Fractional counts should be rejected");
+    test_utils::test_assert(rejects("{\"port\": 65536}"),
+                            "Ports above 65535 should be rejected");
+    test_utils::test_assert(rejects("{\"port\": 99999999999999999999}"),
+                            "Integers past 64 bits should be rejected");
+    test_utils::test_assert(rejects("{\"rate_limit\": "
+                                    "{\"bytes_per_second\": 1e999}}"),
+                            "Infinite numbers should be rejected");
+    test_utils::test_assert(rejects("{\"port\": inf}") &&
+                                rejects("{\"port\": nan}") &&
+                                rejects("{\"port\": 0x50}") &&
+                                rejects("{\"port\": 080}") &&
+                                rejects("{\"port\": +80}"),
+                            "Only JSON number syntax should be accepted");
+    test_utils::test_assert(parse_config("{\"port\": 80}").port == 80 &&
+                                parse_config("{\"cache_rules\": [{\"match\":"
+                                             " \"/\", \"expires\": -1}]}")
+                                        .cache_rules[0]
+                                        .expires == -1,
+                            "Integers in range should be accepted");
+    test_utils::test_assert(parse_config("{\"rate_limit\": "
+                                         "{\"byte_burst\": 1.5e3}}")
+                                    .rate_limit.byte_burst == 1500,
+                            "Rates may be fractional or use exponents");
+    test_utils::test_assert(rejects("{\"rate_limit\": "
+                                    "{\"requests_per_second\": -5}}") &&
+                                rejects("{\"rate_limit\": "
+                                        "{\"prefix_multiplier\": -1}}"),
+                            "Negative rates should be rejected");
+    test_utils::test_assert(parse_config("{\"cache_rules\": [{\"match\":"
+                                         " \"/\", \"expires\": "
+                                         "9223372036854775807}]}")
+                                    .cache_rules[0]
+                                    .expires == 10L * 365 * 24 * 3600,
+                            "Expires should be clamped to ten years");
+}
+
+// Test unicode escapes, including surrogate pairs
+void test_parse_escapes() {
+    test_utils::test_assert(
+        parse_config("{\"root\": \"/\\u00e9\\u20ac\"}").root_directory ==
+            "/\xc3\xa9\xe2\x82\xac",
+        "BMP escapes should become UTF-8");
+    test_utils::test_assert(
+        parse_config("{\"root\": \"/\\ud83d\\ude00\"}").root_directory ==
+            "/\xf0\x9f\x98\x80",
+        "Surrogate pairs should become one character");
+    test_utils::test_assert(rejects("{\"root\": \"\\u00zz\"}"),
+                            "Non-hex escapes should be rejected");
+    test_utils::test_assert(rejects("{\"root\": \"\\ud83d\"}") &&
+                                rejects("{\"root\": \"\\ude00\"}") &&
+                                rejects("{\"root\": \"\\ud83d\\u0041\"}"),
+                            "Unpaired surrogates should be rejected");
+    test_utils::test_assert(
+        parse_config("{\"root\": \"\\\"\\\\\\/\"}").root_directory ==
+            "\"\\/",
+        "Quote, backslash and slash escapes should be kept");
+    test_utils::test_assert(rejects("{\"root\": \"/\\q\"}") &&
+                                rejects("{\"root\": \"/\\x41\"}") &&
+                                rejects("{\"root\": \"/\\'\"}"),
+                            "Unknown escapes should be rejected");
+}
+
+int main() {
+    std::cout << "===== Running Config File Tests =====" << std::endl;
+
+    test_utils::run_test("Parse Full Config", test_parse_full_config);
+    test_utils::run_test("Parse Errors", test_parse_errors);
+    test_utils::run_test("Parse Numbers", test_parse_numbers);
+    test_utils::run_test("Parse Escapes", test_parse_escapes);
+
+    test_utils::print_test_summary();
+
+    return 0;
+}
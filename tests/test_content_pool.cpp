@@ -0,0 +1,125 @@
+#include "../include/content_pool.h"
+#include "../include/topology.h"
+#include "test_utils.hpp"
+#include <iostream>
+#include <string>
+
+// Test that stored bodies read back intact from both pool flavours
+void test_store() {
+    std::vector<int> nodes = topology::memory_nodes();
+    ContentPool plain(false, ContentPool::ANY_NODE, nodes);
+    ContentPool huge(true, ContentPool::INTERLEAVE, nodes);
+
+    std::string small(1000, 's');
+    std::string large(3 * 1024 * 1024, 'L');
+    ContentPool *pools[] = {&plain, &huge};
+    for (size_t i = 0; i < 2; ++i) {
+        Content a = pools[i]->store(small.data(), small.size());
+        Content b = pools[i]->store(large.data(), large.size());
+        test_utils::test_assert(a.size() == small.size() &&
+                                    std::string(a.data(), a.size()) == small,
+                                "Small bodies should round-trip");
+        test_utils::test_assert(b.size() == large.size() &&
+                                    std::string(b.data(), b.size()) == large,
+                                "Bodies with their own mapping should "
+                                "round-trip");
+        test_utils::test_assert(pools[i]->store("", 0).empty(),
+                                "Empty bodies should stay empty");
+    }
+}
+
+// Test that slices are cache-line aligned and outlive the pool
+void test_slices() {
+    Content first;
+    Content second;
+    {
+        ContentPool pool(false, ContentPool::ANY_NODE,
+                         topology::memory_nodes());
+        first = pool.store("abc", 3);
+        second = pool.store("defg", 4);
+    }
+    test_utils::test_assert(reinterpret_cast<uintptr_t>(second.data()) % 64 ==
+                                0,
+                            "Slices should start on a cache line");
+    test_utils::test_assert(std::string(first.data(), 3) == "abc" &&
+                                std::string(second.data(), 4) == "defg",
+                            "Slices should keep their chunk mapped");
+}
+
+// Test that churning bodies reuses freed slots and unmaps empty chunks
+// instead of letting a few live slices pin ever more chunks
+void test_churn() {
+    ContentPool pool(false, ContentPool::ANY_NODE, topology::memory_nodes());
+    std::string body(300 * 1024, 'c');
+    std::vector<Content> kept;
+    Content pinned = pool.store("pin", 3);
+    for (size_t round = 0; round < 200; ++round) {
+        std::vector<Content> live;
+        for (size_t i = 0; i < 40; ++i) {
+            size_t size = 1000 + (round * 7919 + i * 104729) % body.size();
+            live.push_back(pool.store(body.data(), size));
+        }
+        // A few survivors per round keep old chunks partly alive
+        kept.push_back(live[round % live.size()]);
+        if (kept.size() > 8) {
+            kept.erase(kept.begin());
+        }
+    }
+    test_utils::test_assert(pool.mapped_bytes() <= 4 * 8 * 1024 * 1024,
+                            "Churn should not keep mapping new chunks");
+    test_utils::test_assert(std::string(pinned.data(), 3) == "pin",
+                            "Live slices should stay intact");
+
+    kept.clear();
+    pinned = Content();
+    Content large = pool.store(body.data(), body.size());
+    large = Content();
+    test_utils::test_assert(pool.mapped_bytes() <= 8 * 1024 * 1024,
+                            "Chunks with no live slices should be unmapped");
+}
+
+// Test that the byte limit keeps further bodies on the heap
+void test_limit() {
+    ContentPool pool(false, ContentPool::ANY_NODE, topology::memory_nodes(),
+                     1024 * 1024);
+    std::string body(600 * 1024, 'x');
+    Content first = pool.store(body.data(), 1000);
+    Content over = pool.store(body.data(), 3 * 1024 * 1024);
+    test_utils::test_assert(first.slice() != nullptr,
+                            "The first chunk should always be mapped");
+    test_utils::test_assert(over.slice() == nullptr &&
+                                over.size() == 3 * 1024 * 1024 &&
+                                over.data()[0] == 'x',
+                            "Bodies past the limit should use the heap");
+    test_utils::test_assert(pool.mapped_bytes() == 8 * 1024 * 1024,
+                            "The limit should stop further mappings");
+}
+
+// Test the sysfs list parser used for node and CPU lists
+void test_parse_list() {
+    std::vector<int> values = topology::parse_list("0-2,5,8-9");
+    test_utils::test_assert(values.size() == 6 && values[0] == 0 &&
+                                values[2] == 2 && values[3] == 5 &&
+                                values[5] == 9,
+                            "Ranges and single values should expand");
+    test_utils::test_assert(topology::parse_list("").empty(),
+                            "An empty list has no values");
+    test_utils::test_assert(!topology::memory_nodes().empty(),
+                            "There is always at least one memory node");
+    test_utils::test_assert(!topology::online_cpus().empty(),
+                            "There is always at least one CPU");
+}
+
+int main() {
+    std::cout << "===== Running Content Pool Tests =====" << std::endl;
+
+    test_utils::run_test("Store Bodies", test_store);
+    test_utils::run_test("Slice Lifetime", test_slices);
+    test_utils::run_test("Churn", test_churn);
+    test_utils::run_test("Mapping Limit", test_limit);
+    test_utils::run_test("Topology Lists", test_parse_list);
+
+    test_utils::print_test_summary();
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "../include/content_store.h"
+#include "../include/topology.h"
+#include "test_utils.hpp"
+#include <iostream>
+#include <string>
+
+// Test the hash against the reference XXH64 values
+void test_hash() {
+    std::string repetition = "Nobody inspects the spammish repetition";
+    std::string bytes;
+    for (int i = 0; i < 3; ++i) {
+        for (int c = 0; c < 256; ++c) {
+            bytes += static_cast<char>(c);
+        }
+    }
+    test_utils::test_assert(content_hash("", 0) == 0xEF46DB3751D8E999ULL,
+                            "The empty input should match XXH64");
+    test_utils::test_assert(content_hash("abc", 3) == 0x44BC2CF5AD770999ULL,
+                            "Short inputs should match XXH64");
+    test_utils::test_assert(content_hash(repetition.data(),
+                                         repetition.size()) ==
+                                0xFBCEA83C8A378BF1ULL,
+                            "Inputs over one stripe should match XXH64");
+    test_utils::test_assert(content_hash(bytes.data(), bytes.size()) ==
+                                0x8E03C838C596036FULL,
+                            "Long inputs should match XXH64");
+    test_utils::test_assert(content_etag(0x44BC2CF5AD770999ULL) ==
+                                "\"44bc2cf5ad770999\"",
+                            "ETags should be quoted hex");
+}
+
+// Test that identical bodies share a buffer and different ones do not
+void test_intern() {
+    ContentStore store(nullptr);
+    std::string text = "body { color: red }";
+    uint64_t hash = content_hash(text.data(), text.size());
+    Content first = store.intern(hash, text);
+    Content second = store.intern(hash, text);
+    test_utils::test_assert(first.data() == second.data() &&
+                                store.deduplicated() == 1,
+                            "Identical bodies should share one buffer");
+
+    // Same hash, different bytes: must not be merged
+    Content other = store.intern(hash, "body { color: blue }");
+    test_utils::test_assert(other.data() != first.data() &&
+                                std::string(other.data(), other.size()) ==
+                                    "body { color: blue }",
+                            "Hash collisions should be checked byte-wise");
+}
+
+// Test that bodies are freed with their last user and then stored anew
+void test_release() {
+    ContentStore store(nullptr);
+    uint64_t hash = content_hash("abc", 3);
+    {
+        Content body = store.intern(hash, "abc");
+    }
+    Content again = store.intern(hash, "abc");
+    test_utils::test_assert(store.deduplicated() == 0 &&
+                                std::string(again.data(), 3) == "abc",
+                            "Released bodies should not be reused");
+}
+
+// Test interning into a content pool
+void test_pooled() {
+    ContentPool pool(false, ContentPool::ANY_NODE, topology::memory_nodes());
+    ContentStore store(&pool);
+    std::string text(5000, 'p');
+    uint64_t hash = content_hash(text.data(), text.size());
+    Content first = store.intern(hash, text);
+    Content second = store.intern(hash, text);
+    test_utils::test_assert(first.data() == second.data() &&
+                                reinterpret_cast<uintptr_t>(first.data()) %
+                                        64 ==
+                                    0,
+                            "Pooled bodies should be shared slices");
+}
+
+int main() {
+    std::cout << "===== Running Content Store Tests =====" << std::endl;
+
+    test_utils::run_test("Content Hash", test_hash);
+    test_utils::run_test("Intern", test_intern);
+    test_utils::run_test("Release", test_release);
+    test_utils::run_test("Pooled Bodies", test_pooled);
+
+    test_utils::print_test_summary();
+
+    return 0;
+}
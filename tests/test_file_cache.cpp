@@ -0,0 +1,164 @@
+#include "../include/file_cache.h"
+#include "../include/content_pool.h"
+#include "test_utils.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Test that prepared headers are formatted once per entry
+void test_build_cached_file() {
+    std::shared_ptr<CachedFile> file =
+        build_cached_file(200, "text/html", "<html></html>");
+    test_utils::test_assert(file->http1_header ==
+                                "HTTP/1.1 200 OK\r\n"
+                                "Content-Type: text/html\r\n"
+                                "Content-Length: 13\r\n"
+                                "\r\n",
+                            "HTTP/1.1 header should be preformatted");
+    test_utils::test_assert(!file->hpack_header.empty() &&
+                                static_cast<uint8_t>(file->hpack_header[0]) ==
+                                    0x88,
+                            "HPACK block should start with :status 200");
+
+    std::shared_ptr<CachedFile> empty = build_cached_file(405, "", "");
+    test_utils::test_assert(empty->http1_header ==
+                                "HTTP/1.1 405 Method Not Allowed\r\n"
+                                "Content-Length: 0\r\n"
+                                "\r\n",
+                            "Empty content type should omit the header");
+
+    hpack::HeaderList etag;
+    etag.push_back(hpack::Header("ETag", "\"1\""));
+    std::shared_ptr<CachedFile> not_modified =
+        build_cached_file(304, "", "", etag);
+    test_utils::test_assert(not_modified->http1_header ==
+                                "HTTP/1.1 304 Not Modified\r\n"
+                                "ETag: \"1\"\r\n"
+                                "\r\n",
+                            "304 responses should not carry a length");
+}
+
+// Test that small responses are also kept as one header-and-body buffer
+void test_packet() {
+    std::shared_ptr<CachedFile> small =
+        build_cached_file(200, "text/plain", "tiny");
+    test_utils::test_assert(std::string(small->packet.data(),
+                                        small->packet.size()) ==
+                                small->http1_header + "tiny",
+                            "Small bodies should follow their header");
+
+    std::shared_ptr<CachedFile> large = build_cached_file(
+        200, "text/plain", std::string(PACKET_BODY_LIMIT + 1, 'x'));
+    std::shared_ptr<CachedFile> empty = build_cached_file(404, "", "");
+    test_utils::test_assert(large->packet.empty() && empty->packet.empty(),
+                            "Large and empty bodies should not be copied");
+
+    // With a pool the packet is placed next to pooled bodies
+    ContentPool pool(false, ContentPool::ANY_NODE, std::vector<int>());
+    std::shared_ptr<CachedFile> pooled = build_cached_file(
+        200, "text/plain", "tiny", hpack::HeaderList(), &pool);
+    test_utils::test_assert(pooled->packet.slice() &&
+                                std::string(pooled->packet.data(),
+                                            pooled->packet.size()) ==
+                                    pooled->http1_header + "tiny",
+                            "The packet should be stored in the pool");
+}
+
+// Test lookups and LRU eviction by byte size, headers included
+void test_cache_eviction() {
+    // Every four-byte entry below has the same size
+    std::shared_ptr<CachedFile> sample =
+        build_cached_file(200, "text/plain", "aaaa");
+    size_t entry = cached_size(*sample);
+    test_utils::test_assert(entry == 4 + sample->content_type.size() +
+                                         sample->http1_header.size() +
+                                         sample->hpack_header.size() +
+                                         sample->packet.size(),
+                            "Entry sizes should count the headers");
+    FileCache cache(2 * entry + entry / 2);
+    cache.insert("/a", build_cached_file(200, "text/plain", "aaaa"));
+    cache.insert("/b", build_cached_file(200, "text/plain", "bbbb"));
+    test_utils::test_assert(cache.find("/a") != nullptr,
+                            "Inserted entry should be found");
+
+    // /a was just used, so /b is the eviction victim
+    cache.insert("/c", build_cached_file(200, "text/plain", "cccc"));
+    test_utils::test_assert(cache.find("/b") == nullptr,
+                            "Least recently used entry should be evicted");
+    test_utils::test_assert(cache.find("/a") != nullptr &&
+                                cache.find("/c") != nullptr,
+                            "Recent entries should survive");
+    test_utils::test_assert(cache.size_bytes() == 2 * entry,
+                            "Size should track cached bytes");
+
+    cache.insert("/huge", build_cached_file(200, "text/plain",
+                                            std::string(2 * entry, 'x')));
+    test_utils::test_assert(cache.find("/huge") == nullptr,
+                            "Entries larger than the cache are skipped");
+
+    cache.erase("/a");
+    test_utils::test_assert(cache.entry_count() == 1,
+                            "Erase should drop the entry");
+}
+
+// Test that the hot set ranks entries by hits and ages them
+void test_hot_set() {
+    FileCache cache(1024);
+    cache.insert("/cold", build_cached_file(200, "text/plain", "c"));
+    cache.insert("/warm", build_cached_file(200, "text/plain", "w"));
+    cache.insert("/hot", build_cached_file(200, "text/plain", "h"));
+    for (int i = 0; i < 4; ++i) {
+        cache.find("/hot");
+    }
+    cache.find("/warm");
+
+    std::vector<std::pair<std::string, uint64_t>> hot = cache.hot_set(10);
+    test_utils::test_assert(hot.size() == 3,
+                            "Every cached entry should be listed");
+    test_utils::test_assert(hot[0].first == "/hot" && hot[0].second == 4 &&
+                                hot[1].first == "/warm" &&
+                                hot[2].first == "/cold",
+                            "Entries should be ordered by hits");
+
+    // Refreshing an entry keeps its history; counts halve per snapshot
+    cache.insert("/hot", build_cached_file(200, "text/plain", "H"));
+    hot = cache.hot_set(1);
+    test_utils::test_assert(hot.size() == 1 && hot[0].first == "/hot" &&
+                                hot[0].second == 2,
+                            "Counts should survive refresh and decay by half");
+}
+
+// Test that purges drop single keys, prefixes and everything
+void test_purge() {
+    FileCache cache(1024);
+    cache.insert("/css/a.css", build_cached_file(200, "text/css", "a"));
+    cache.insert("/css/b.css", build_cached_file(200, "text/css", "b"));
+    cache.insert("/index.html", build_cached_file(200, "text/html", "i"));
+
+    test_utils::test_assert(cache.erase("/index.html") &&
+                                !cache.erase("/index.html"),
+                            "Erase should report whether the key was cached");
+    test_utils::test_assert(cache.erase_prefix("/css/") == 2 &&
+                                cache.entry_count() == 0,
+                            "Prefix erase should drop every matching key");
+
+    cache.insert("/a", build_cached_file(200, "text/plain", "a"));
+    cache.clear();
+    test_utils::test_assert(cache.entry_count() == 0 &&
+                                cache.size_bytes() == 0,
+                            "Clear should empty the cache");
+}
+
+int main() {
+    std::cout << "===== Running File Cache Tests =====" << std::endl;
+
+    test_utils::run_test("Build Cached File", test_build_cached_file);
+    test_utils::run_test("Packet", test_packet);
+    test_utils::run_test("Cache Eviction", test_cache_eviction);
+    test_utils::run_test("Hot Set", test_hot_set);
+    test_utils::run_test("Purge", test_purge);
+
+    test_utils::print_test_summary();
+
+    return 0;
+}
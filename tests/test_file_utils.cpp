@@ -1,7 +1,17 @@
 #include "../include/file_utils.h"
 #include "test_utils.hpp"
+#include <cstddef>
+#include <fcntl.h>
 #include <iostream>
 #include <string>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/filter.h>
+#include <linux/seccomp.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#endif
 
 // Test file existence function
 void test_file_exists() {
@@ -127,6 +137,155 @@ void test_read_nonexistent_file() {
         "read_file() should throw exception for non-existent file");
 }
 
+// Helper: normalize a copy and return it, or "<invalid>" on rejection
+static std::string normalized(const std::string &path) {
+    std::string copy = path;
+    if (!file_utils::normalize_path(copy)) {
+        return "<invalid>";
+    }
+    return copy;
+}
+
+// Test request path canonicalization
+void test_normalize_path() {
+    test_utils::test_assert(normalized("/index.html") == "/index.html",
+                            "Plain paths should be unchanged");
+    test_utils::test_assert(normalized("/a/../index.html") == "/index.html",
+                            "Dot-dot segments should be removed");
+    test_utils::test_assert(normalized("/./a//b/./c") == "/a/b/c",
+                            "Dot segments and duplicate slashes should go");
+    test_utils::test_assert(normalized("/a/b/..") == "/a/",
+                            "Trailing dot-dot should leave a directory path");
+    test_utils::test_assert(normalized("/hello%20world.txt") ==
+                                "/hello world.txt",
+                            "Percent escapes should be decoded");
+    test_utils::test_assert(normalized("/a/%2e%2E/b") == "/b",
+                            "Encoded dots should be treated as dot segments");
+
+    // Traversal and malformed input
+    test_utils::test_assert(normalized("/../etc/passwd") == "<invalid>",
+                            "Climbing above the root should be rejected");
+    test_utils::test_assert(normalized("/a/%2e%2e/%2e%2e/x") == "<invalid>",
+                            "Encoded traversal should be rejected");
+    test_utils::test_assert(normalized("/a%00b") == "<invalid>",
+                            "Encoded NUL should be rejected");
+    test_utils::test_assert(normalized("/bad%2") == "<invalid>",
+                            "Truncated escapes should be rejected");
+    test_utils::test_assert(normalized("/bad%zz") == "<invalid>",
+                            "Non-hex escapes should be rejected");
+    test_utils::test_assert(normalized("relative") == "<invalid>",
+                            "Paths must start with a slash");
+    test_utils::test_assert(normalized("") == "<invalid>",
+                            "Empty paths should be rejected");
+}
+
+// Test that directories resolve to their index file
+void test_request_key() {
+    std::string key;
+    test_utils::test_assert(file_utils::request_key("/docs/", key) &&
+                                key == "/docs/index.html",
+                            "Directories should map to index.html");
+    test_utils::test_assert(file_utils::request_key("/a/b/..", key) &&
+                                key == "/a/index.html",
+                            "A trailing dot-dot names a directory");
+    test_utils::test_assert(!file_utils::request_key("/../x", key),
+                            "Rejected paths should not produce a key");
+}
+
+// Test confined opens relative to a directory descriptor
+void test_open_beneath() {
+    const std::string ROOT = "beneath_root";
+    test_utils::ensure_directory(ROOT + "/sub");
+    test_utils::create_test_file(ROOT + "/sub/file.txt", "inside");
+    test_utils::create_test_file("outside_file.txt", "outside");
+    int link_result = symlink("../outside_file.txt",
+                              (ROOT + "/escape.txt").c_str());
+
+    int root_fd = open(ROOT.c_str(), O_RDONLY | O_DIRECTORY);
+    test_utils::test_assert(root_fd >= 0, "Failed to open test root");
+
+    int fd = file_utils::open_beneath(root_fd, "sub/file.txt");
+    test_utils::test_assert(fd >= 0, "open_beneath() should open files inside");
+    test_utils::test_assert(file_utils::read_fd(fd, 6) == "inside",
+                            "read_fd() should return file content");
+    close(fd);
+
+    fd = file_utils::open_beneath(root_fd, "missing.txt");
+    test_utils::test_assert(fd < 0, "open_beneath() should fail for missing");
+
+#ifdef __linux__
+    if (link_result == 0) {
+        fd = file_utils::open_beneath(root_fd, "escape.txt");
+        bool escaped = fd >= 0;
+        if (fd >= 0) {
+            close(fd);
+        }
+        test_utils::test_assert(!escaped,
+                                "Symlinks leaving the root should be refused");
+    }
+#endif
+
+    close(root_fd);
+    test_utils::cleanup_test_file(ROOT + "/escape.txt");
+    test_utils::cleanup_test_file(ROOT + "/sub/file.txt");
+    test_utils::cleanup_test_file("outside_file.txt");
+    system(("rm -rf " + ROOT).c_str());
+}
+
+// Test that opens still work where a seccomp policy refuses openat2
+void test_open_beneath_filtered() {
+#if defined(__linux__) && defined(SYS_openat2)
+    const std::string ROOT = "filtered_root";
+    test_utils::ensure_directory(ROOT);
+    test_utils::create_test_file(ROOT + "/file.txt", "inside");
+
+    pid_t child = fork();
+    if (child == 0) {
+        // openat2 fails with EPERM; every other call is allowed
+        struct sock_filter filter[] = {
+            BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+                     offsetof(struct seccomp_data, nr)),
+            BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, SYS_openat2, 0, 1),
+            BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ERRNO | EPERM),
+            BPF_STMT(BPF_RET | BPF_K, SECCOMP_RET_ALLOW),
+        };
+        struct sock_fprog program;
+        program.len = sizeof(filter) / sizeof(filter[0]);
+        program.filter = filter;
+        if (prctl(PR_SET_NO_NEW_PRIVS, 1, 0, 0, 0) != 0 ||
+            prctl(PR_SET_SECCOMP, SECCOMP_MODE_FILTER, &program) != 0) {
+            _exit(2);
+        }
+        int root_fd = open(ROOT.c_str(), O_RDONLY | O_DIRECTORY);
+        bool opened = file_utils::open_beneath(root_fd, "file.txt") >= 0 &&
+                      file_utils::open_beneath(root_fd, "file.txt") >= 0;
+        _exit(opened ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    test_utils::test_assert(WIFEXITED(status) && WEXITSTATUS(status) != 1,
+                            "A filtered openat2 should fall back to openat");
+    system(("rm -rf " + ROOT).c_str());
+#endif
+}
+
+// Test pulling a file into the page cache
+void test_prefetch_fd() {
+    const std::string PREFETCH_FILE = "prefetch_file.txt";
+    test_utils::create_test_file(PREFETCH_FILE, std::string(64 * 1024, 'P'));
+
+    int fd = open(PREFETCH_FILE.c_str(), O_RDONLY);
+    test_utils::test_assert(file_utils::prefetch_fd(fd, 64 * 1024),
+                            "prefetch_fd() should succeed on regular files");
+    test_utils::test_assert(file_utils::prefetch_fd(fd, 0),
+                            "Empty prefetches should succeed");
+    close(fd);
+    test_utils::test_assert(!file_utils::prefetch_fd(-1, 4096),
+                            "prefetch_fd() should fail on bad descriptors");
+
+    test_utils::cleanup_test_file(PREFETCH_FILE);
+}
+
 int main() {
     std::cout << "===== Running File Utils Tests =====" << std::endl;
 
@@ -137,6 +296,11 @@ int main() {
     test_utils::run_test("File Extension", test_file_extension);
     test_utils::run_test("Non-existent File Reading",
                          test_read_nonexistent_file);
+    test_utils::run_test("Path Normalization", test_normalize_path);
+    test_utils::run_test("Request Key", test_request_key);
+    test_utils::run_test("Confined Open", test_open_beneath);
+    test_utils::run_test("Filtered Confined Open", test_open_beneath_filtered);
+    test_utils::run_test("Page Cache Prefetch", test_prefetch_fd);
 
     test_utils::print_test_summary();
 
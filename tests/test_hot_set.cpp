@@ -0,0 +1,70 @@
+#include "../include/hot_set.h"
+#include "test_utils.hpp"
+#include <fstream>
+#include <iostream>
+#include <string>
+
+// Test that a saved snapshot loads back unchanged
+void test_roundtrip() {
+    const std::string SNAPSHOT = "hot_set_test.txt";
+    std::vector<hot_set::Entry> entries;
+    hot_set::Entry entry;
+    entry.host = "*";
+    entry.key = "/index.html";
+    entry.hits = 42;
+    entries.push_back(entry);
+    entry.host = "example.test";
+    entry.key = "gzip:/app.js";
+    entry.hits = 7;
+    entries.push_back(entry);
+    entry.key = "/bad\tkey";
+    entries.push_back(entry);
+
+    test_utils::test_assert(hot_set::save(SNAPSHOT, entries),
+                            "Saving a snapshot should succeed");
+    std::vector<hot_set::Entry> loaded = hot_set::load(SNAPSHOT);
+    test_utils::test_assert(loaded.size() == 2,
+                            "Keys that break the format should be skipped");
+    test_utils::test_assert(loaded[0].host == "*" &&
+                                loaded[0].key == "/index.html" &&
+                                loaded[0].hits == 42,
+                            "The first entry should round-trip");
+    test_utils::test_assert(loaded[1].host == "example.test" &&
+                                loaded[1].key == "gzip:/app.js" &&
+                                loaded[1].hits == 7,
+                            "The second entry should round-trip");
+    test_utils::test_assert(!std::ifstream((SNAPSHOT + ".tmp").c_str()),
+                            "The temporary file should be renamed away");
+
+    test_utils::cleanup_test_file(SNAPSHOT);
+}
+
+// Test that missing or foreign files give an empty set
+void test_bad_snapshots() {
+    test_utils::test_assert(hot_set::load("no_such_snapshot.txt").empty(),
+                            "A missing snapshot should load as empty");
+
+    const std::string FOREIGN = "foreign_snapshot.txt";
+    test_utils::create_test_file(FOREIGN, "1\t*\t/index.html\n");
+    test_utils::test_assert(hot_set::load(FOREIGN).empty(),
+                            "Files without the header should be ignored");
+
+    test_utils::create_test_file(FOREIGN, "# static_server hot set v1\n"
+                                          "garbage\n"
+                                          "3\t*\t/ok.html\n");
+    std::vector<hot_set::Entry> loaded = hot_set::load(FOREIGN);
+    test_utils::test_assert(loaded.size() == 1 && loaded[0].key == "/ok.html",
+                            "Malformed lines should be skipped");
+    test_utils::cleanup_test_file(FOREIGN);
+}
+
+int main() {
+    std::cout << "===== Running Hot Set Tests =====" << std::endl;
+
+    test_utils::run_test("Snapshot Roundtrip", test_roundtrip);
+    test_utils::run_test("Bad Snapshots", test_bad_snapshots);
+
+    test_utils::print_test_summary();
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "../include/hpack.h"
+#include "test_utils.hpp"
+#include <iostream>
+#include <string>
+
+// Helper: turn a hex string into raw bytes
+static std::string from_hex(const std::string &hex) {
+    std::string out;
+    for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+        out += static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16));
+    }
+    return out;
+}
+
+static bool decode(hpack::Decoder &decoder, const std::string &block,
+                   hpack::HeaderList &headers) {
+    headers.clear();
+    return decoder.decode(reinterpret_cast<const uint8_t *>(block.data()),
+                          block.size(), headers);
+}
+
+// Test decoding the RFC 7541 C.4 request sequence (Huffman + dynamic table)
+void test_decode_rfc_requests() {
+    hpack::Decoder decoder;
+    hpack::HeaderList headers;
+
+    test_utils::test_assert(
+        decode(decoder, from_hex("828684418cf1e3c2e5f23a6ba0ab90f4ff"),
+               headers),
+        "First request should decode");
+    test_utils::test_assert(headers.size() == 4, "First request has 4 fields");
+    test_utils::test_assert(headers[1].second == "http",
+                            "Scheme should come from the static table");
+    test_utils::test_assert(headers[3].first == ":authority" &&
+                                headers[3].second == "www.example.com",
+                            "Huffman-coded authority should decode");
+
+    test_utils::test_assert(
+        decode(decoder, from_hex("828684be5886a8eb10649cbf"), headers),
+        "Second request should decode");
+    test_utils::test_assert(headers[3].second == "www.example.com",
+                            "Authority should come from the dynamic table");
+    test_utils::test_assert(headers[4].first == "cache-control" &&
+                                headers[4].second == "no-cache",
+                            "Cache-control should decode");
+
+    test_utils::test_assert(
+        decode(decoder,
+               from_hex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf"),
+               headers),
+        "Third request should decode");
+    test_utils::test_assert(headers[2].second == "/index.html",
+                            "Path should come from the static table");
+    test_utils::test_assert(headers[4].first == "custom-key" &&
+                                headers[4].second == "custom-value",
+                            "Literal name and value should decode");
+}
+
+// Test that malformed blocks are rejected
+void test_decode_errors() {
+    hpack::Decoder decoder;
+    hpack::HeaderList headers;
+
+    test_utils::test_assert(!decode(decoder, from_hex("80"), headers),
+                            "Index 0 should be rejected");
+    test_utils::test_assert(!decode(decoder, from_hex("ff00"), headers),
+                            "Unknown dynamic index should be rejected");
+    test_utils::test_assert(!decode(decoder, from_hex("400a"), headers),
+                            "Truncated literal should be rejected");
+    test_utils::test_assert(!decode(decoder, from_hex("3fe21f"), headers),
+                            "Table size above the limit should be rejected");
+    test_utils::test_assert(!decode(decoder, from_hex("8220"), headers),
+                            "Table size update after a field should fail");
+
+    hpack::Decoder limited(4096, 100);
+    test_utils::test_assert(decode(limited, from_hex("8286"), headers),
+                            "A list under the limit should decode");
+    test_utils::test_assert(!decode(limited, from_hex("828684"), headers),
+                            "A list over the limit should be rejected");
+}
+
+// Test that encoded blocks round-trip through the decoder
+void test_encode_roundtrip() {
+    std::string block;
+    hpack::encode_header(block, ":status", "200");
+    hpack::encode_header(block, "content-type", "text/html");
+    hpack::encode_header(block, "content-length", "12345");
+    hpack::encode_header(block, "x-custom", "value");
+
+    test_utils::test_assert(static_cast<uint8_t>(block[0]) == 0x88,
+                            ":status 200 should be static index 8");
+
+    hpack::Decoder decoder;
+    hpack::HeaderList headers;
+    test_utils::test_assert(decode(decoder, block, headers),
+                            "Encoded block should decode");
+    test_utils::test_assert(headers.size() == 4, "All fields should decode");
+    test_utils::test_assert(headers[1].second == "text/html",
+                            "Content-type should round-trip");
+    test_utils::test_assert(headers[2].second == "12345",
+                            "Content-length should round-trip");
+    test_utils::test_assert(headers[3].first == "x-custom",
+                            "Literal names should round-trip");
+
+    // Multi-byte integers
+    std::string integer;
+    hpack::encode_integer(integer, 1337, 5, 0x00);
+    test_utils::test_assert(integer == from_hex("1f9a0a"),
+                            "1337 with a 5-bit prefix should match RFC C.1.2");
+}
+
+int main() {
+    std::cout << "===== Running HPACK Tests =====" << std::endl;
+
+    test_utils::run_test("Decode RFC Requests", test_decode_rfc_requests);
+    test_utils::run_test("Decode Errors", test_decode_errors);
+    test_utils::run_test("Encode Roundtrip", test_encode_roundtrip);
+
+    test_utils::print_test_summary();
+
+    return 0;
+}
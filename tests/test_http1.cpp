@@ -0,0 +1,437 @@
+#include "../include/file_utils.h"
+#include "../include/http1.h"
+#include "test_utils.hpp"
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <strings.h>
+#include <vector>
+
+// Oracle for the differential test below. parse_request is the
+// stream-based original the in-place parser replaced. The header lookup,
+// keep-alive and path resolver are separate straightforward models, not
+// copies of the code under test. Change them only to fix the reference
+// itself.
+namespace reference {
+void parse_request(const std::string &request, std::string &path,
+                   std::string &method) {
+    std::istringstream request_stream(request);
+
+    // Get the first line
+    std::string first_line;
+    std::getline(request_stream, first_line, '\r');
+
+    // Parse the first line
+    std::istringstream first_line_stream(first_line);
+    first_line_stream >> method >> path;
+
+    // Remove URL parameters if any
+    size_t param_pos = path.find('?');
+    if (param_pos != std::string::npos) {
+        path = path.substr(0, param_pos);
+    }
+}
+
+// The CRLF-terminated lines of a head, without their CRLF. A bare LF
+// stays inside its line, and an unterminated tail is not a line.
+std::vector<std::string> lines(const std::string &head) {
+    std::vector<std::string> result;
+    std::istringstream stream(head);
+    std::string piece;
+    std::string line;
+    while (std::getline(stream, piece, '\n') && !stream.eof()) {
+        line += piece;
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+            line.erase(line.size() - 1);
+            result.push_back(line);
+            line.clear();
+        } else {
+            line += '\n';
+        }
+    }
+    return result;
+}
+
+std::string trim(const std::string &text) {
+    size_t begin = 0;
+    size_t end = text.size();
+    while (begin < end && (text[begin] == ' ' || text[begin] == '\t')) {
+        ++begin;
+    }
+    while (end > begin && (text[end - 1] == ' ' || text[end - 1] == '\t')) {
+        --end;
+    }
+    return text.substr(begin, end - begin);
+}
+
+std::string lowercase(std::string text) {
+    for (size_t i = 0; i < text.size(); ++i) {
+        text[i] = static_cast<char>(tolower((unsigned char)text[i]));
+    }
+    return text;
+}
+
+// Every line after the request line is a field; the first whose name
+// (everything before the first colon) matches wins
+std::string find_header(const std::string &request, const char *name) {
+    std::vector<std::string> fields = lines(request);
+    for (size_t i = 1; i < fields.size(); ++i) {
+        size_t colon = fields[i].find(':');
+        if (colon != std::string::npos &&
+            lowercase(fields[i].substr(0, colon)) == name) {
+            return trim(fields[i].substr(colon + 1));
+        }
+    }
+    return "";
+}
+
+// The version is the last space-separated word of the request line
+bool keep_alive(const std::string &request) {
+    std::vector<std::string> all = lines(request);
+    if (all.empty()) {
+        return false;
+    }
+    size_t space = all[0].rfind(' ');
+    if (space == std::string::npos || all[0].substr(space + 1) != "HTTP/1.1") {
+        return false;
+    }
+    return lowercase(find_header(request, "connection")).find("close") ==
+           std::string::npos;
+}
+
+// Segment by segment rather than in place: split on '/', decode each
+// segment, then apply "." and ".." to a stack
+bool request_key(const std::string &target, std::string &key) {
+    if (target.empty() || target[0] != '/') {
+        return false;
+    }
+    std::string decoded;
+    for (size_t i = 0; i < target.size(); ++i) {
+        char c = target[i];
+        if (c == '%') {
+            if (i + 2 >= target.size() ||
+                !isxdigit((unsigned char)target[i + 1]) ||
+                !isxdigit((unsigned char)target[i + 2])) {
+                return false;
+            }
+            c = static_cast<char>(
+                strtol(target.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        }
+        if (c == '\0') {
+            return false;
+        }
+        decoded += c;
+    }
+
+    std::vector<std::string> segments;
+    size_t begin = 1;
+    while (true) {
+        size_t end = decoded.find('/', begin);
+        std::string segment = decoded.substr(
+            begin, end == std::string::npos ? std::string::npos : end - begin);
+        if (segment == "..") {
+            if (segments.empty()) {
+                return false;
+            }
+            segments.pop_back();
+        } else if (!segment.empty() && segment != ".") {
+            segments.push_back(segment);
+        }
+        if (end == std::string::npos) {
+            // A trailing "", "." or ".." names the directory itself
+            bool directory = segment.empty() || segment == "." ||
+                             segment == "..";
+            key = "/";
+            for (size_t s = 0; s < segments.size(); ++s) {
+                key += segments[s];
+                if (s + 1 < segments.size() || directory) {
+                    key += '/';
+                }
+            }
+            if (key[key.size() - 1] == '/') {
+                key += "index.html";
+            }
+            return true;
+        }
+        begin = end + 1;
+    }
+}
+} // namespace reference
+
+namespace {
+// Everything routing depends on, for one request head
+struct Decision {
+    HttpRequest request;
+    bool keep_alive;
+    bool routed;
+    std::string key;
+};
+
+Decision current(const std::string &head) {
+    Decision decision;
+    decision.request = http1::parse_request(head);
+    decision.keep_alive = http1::keep_alive(head);
+    decision.routed =
+        file_utils::request_key(decision.request.path, decision.key);
+    return decision;
+}
+
+Decision expected(const std::string &head) {
+    Decision decision;
+    reference::parse_request(head, decision.request.path,
+                             decision.request.method);
+    decision.request.host = reference::find_header(head, "host");
+    decision.request.accept_encoding =
+        reference::find_header(head, "accept-encoding");
+    decision.request.if_none_match =
+        reference::find_header(head, "if-none-match");
+    decision.keep_alive = reference::keep_alive(head);
+    decision.routed =
+        reference::request_key(decision.request.path, decision.key);
+    return decision;
+}
+
+bool same(const Decision &a, const Decision &b) {
+    return a.request.method == b.request.method &&
+           a.request.path == b.request.path &&
+           a.request.host == b.request.host &&
+           a.request.accept_encoding == b.request.accept_encoding &&
+           a.request.if_none_match == b.request.if_none_match &&
+           a.keep_alive == b.keep_alive && a.routed == b.routed &&
+           (!a.routed || a.key == b.key);
+}
+
+// xorshift64*, so runs are reproducible from a seed
+struct Random {
+    uint64_t state;
+    explicit Random(uint64_t seed) : state(seed | 1) {}
+    uint64_t next() {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+    size_t below(size_t n) { return static_cast<size_t>(next() % n); }
+    template <size_t N> const char *pick(const char *const (&items)[N]) {
+        return items[below(N)];
+    }
+};
+
+const char *const METHODS[] = {"GET", "HEAD", "POST", "get", "G\tET", ""};
+const char *const SEGMENTS[] = {"a",     "index.html", ".",   "..",  "",
+                                "%2e",   "%2E%2e",     "%2f", "%00", "%",
+                                "%4",    "%zz",        "b?c", "?",   "~",
+                                "%41%42", "x y",       "\t",  "\v",  "é"};
+const char *const VERSIONS[] = {"HTTP/1.1", "HTTP/1.0", "HTTP/2.0",
+                                "http/1.1", "HTTP/1.1 ", ""};
+const char *const NAMES[] = {"Host",         "host",       "HOST",
+                             "Connection",   "connection", "Accept-Encoding",
+                             "If-None-Match", "X-Host",    "Host ",
+                             ""};
+const char *const VALUES[] = {"example.com", " close ", "keep-alive",
+                              "gzip, br",    "\"1\"",   "\t",
+                              "Close",       "",        "a:b"};
+const char *const SEPARATORS[] = {" ", " ", " ", "  ", "\t", "\n", "\f"};
+const char *const ENDINGS[] = {"\r\n", "\r\n", "\r\n", "\n", "\r", ""};
+
+// A request head built from fragments that sit on parsing edge cases,
+// with a few bytes flipped in some of them
+std::string generate(Random &random) {
+    std::string head = random.pick(METHODS);
+    head += random.pick(SEPARATORS);
+    if (random.below(8) != 0) {
+        head += '/';
+    }
+    size_t segments = random.below(6);
+    for (size_t s = 0; s < segments; ++s) {
+        head += random.pick(SEGMENTS);
+        if (s + 1 < segments || random.below(2) == 0) {
+            head += '/';
+        }
+    }
+    head += random.pick(SEPARATORS);
+    head += random.pick(VERSIONS);
+    head += random.pick(ENDINGS);
+
+    size_t headers = random.below(5);
+    for (size_t h = 0; h < headers; ++h) {
+        head += random.pick(NAMES);
+        head += random.below(6) == 0 ? "" : ":";
+        head += random.pick(VALUES);
+        head += random.pick(ENDINGS);
+    }
+    head += "\r\n";
+
+    if (random.below(4) == 0) {
+        size_t flips = 1 + random.below(3);
+        for (size_t f = 0; f < flips; ++f) {
+            head[random.below(head.size())] =
+                static_cast<char>(random.below(256));
+        }
+    }
+    return head;
+}
+
+size_t iterations = 200000; // Override with the first argument
+} // namespace
+
+// Test the request line split on known inputs
+void test_parse_request() {
+    HttpRequest request = http1::parse_request(
+        "GET /a/b.css?v=2 HTTP/1.1\r\nHost: Example.com \r\n"
+        "Accept-Encoding: gzip\r\nIf-None-Match: \"1\"\r\n\r\n");
+    test_utils::test_assert(request.method == "GET" &&
+                                request.path == "/a/b.css",
+                            "The query string should be dropped");
+    test_utils::test_assert(request.host == "Example.com" &&
+                                request.accept_encoding == "gzip" &&
+                                request.if_none_match == "\"1\"",
+                            "Routing headers should be trimmed");
+
+    request = http1::parse_request("  GET\t\t/x  HTTP/1.1\r\n\r\n");
+    test_utils::test_assert(request.method == "GET" && request.path == "/x",
+                            "Any run of whitespace should split words");
+    request = http1::parse_request("\r\n\r\n");
+    test_utils::test_assert(request.method.empty() && request.path.empty(),
+                            "An empty request line has no words");
+    request = http1::parse_request("GET / HTTP/1.1\r\nHost: \t\r\n\r\n");
+    test_utils::test_assert(request.host.empty(),
+                            "A blank header value should read as empty");
+}
+
+// Test keep-alive decisions by version and Connection header
+void test_keep_alive() {
+    test_utils::test_assert(http1::keep_alive("GET / HTTP/1.1\r\n\r\n"),
+                            "HTTP/1.1 should persist");
+    test_utils::test_assert(
+        !http1::keep_alive("GET / HTTP/1.1\r\nConnection: Close\r\n\r\n"),
+        "Connection: close should end the connection");
+    test_utils::test_assert(!http1::keep_alive("GET / HTTP/1.0\r\n\r\n"),
+                            "HTTP/1.0 should close");
+}
+
+// Test body framing, which decides where the next request starts
+void test_body_length() {
+    size_t length = 1;
+    test_utils::test_assert(http1::body_length("GET / HTTP/1.1\r\n\r\n",
+                                               length) &&
+                                length == 0,
+                            "No Content-Length means no body");
+    test_utils::test_assert(
+        http1::body_length("POST / HTTP/1.1\r\ncontent-length:  12 \r\n"
+                           "Content-Length: 12\r\n\r\n",
+                           length) &&
+            length == 12,
+        "Repeated equal lengths should be accepted");
+    test_utils::test_assert(
+        !http1::body_length("POST / HTTP/1.1\r\nContent-Length: 1\r\n"
+                            "Content-Length: 2\r\n\r\n",
+                            length),
+        "Conflicting lengths should be refused");
+    test_utils::test_assert(
+        !http1::body_length("POST / HTTP/1.1\r\nContent-Length: 1x\r\n\r\n",
+                            length) &&
+            !http1::body_length(
+                "POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n", length) &&
+            !http1::body_length(
+                "POST / HTTP/1.1\r\nContent-Length : 1\r\n\r\n", length) &&
+            !http1::body_length("POST / HTTP/1.1\r\nContent-Length: "
+                                "99999999999999999999\r\n\r\n",
+                                length),
+        "Malformed lengths should be refused");
+    test_utils::test_assert(
+        !http1::body_length("POST / HTTP/1.1\r\nTransfer-Encoding: "
+                            "identity\r\n\r\n",
+                            length) &&
+            !http1::body_length("POST / HTTP/1.1\r\nX: y\n"
+                                "transfer-encoding: chunked\r\n\r\n",
+                                length),
+        "Transfer-Encoding should be refused, even after a bare LF");
+}
+
+// Test that header lookup and body framing split mixed line endings the
+// same way, so neither sees a header the other misses
+void test_mixed_line_endings() {
+    const char *heads[] = {
+        "POST / HTTP/1.1\r\nHost: a\nContent-Length: 5\r\n\r\n",
+        "POST / HTTP/1.1\nContent-Length: 5\r\nHost: a\r\n\r\n",
+        "POST / HTTP/1.1\r\nContent-Length: 5\r\n\n\r\n",
+    };
+    for (size_t i = 0; i < 3; ++i) {
+        std::string head = heads[i];
+        size_t length = 0;
+        test_utils::test_assert(!http1::body_length(head, length),
+                                "A bare LF should be refused");
+        test_utils::test_assert(
+            http1::find_header(head, "host") ==
+                    reference::find_header(head, "host") &&
+                http1::find_header(head, "content-length") ==
+                    reference::find_header(head, "content-length"),
+            "Headers should be found on CRLF lines only");
+    }
+    test_utils::test_assert(
+        http1::find_header(heads[1], "content-length").empty() &&
+            http1::find_header(heads[0], "content-length").empty(),
+        "A header after a bare LF is part of the previous line");
+
+    std::string head = "POST / HTTP/1.1\r\nHost: a\r\nX: y\r\n"
+                       "Content-Length: 5\r\n\r\n";
+    size_t length = 0;
+    test_utils::test_assert(http1::body_length(head, length) && length == 5 &&
+                                http1::find_header(head, "content-length") ==
+                                    "5",
+                            "Both should agree on CRLF-only heads");
+}
+
+// Test that the current parser and resolver route every generated
+// request exactly as the reference does
+void test_differential() {
+    Random random(0x5eed);
+    std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        std::string head = generate(random);
+        if (!same(current(head), expected(head))) {
+            std::string escaped;
+            for (size_t c = 0; c < head.size(); ++c) {
+                char hex[8];
+                snprintf(hex, sizeof(hex), isprint((unsigned char)head[c])
+                                               ? "%c"
+                                               : "\\x%02x",
+                         (unsigned char)head[c]);
+                escaped += hex;
+            }
+            throw std::runtime_error("Routing differs for \"" + escaped +
+                                     "\"");
+        }
+    }
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    std::cout << "  " << iterations << " requests, "
+              << static_cast<uint64_t>(iterations / seconds)
+              << " per second" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::cout << "===== Running HTTP/1 Tests =====" << std::endl;
+    if (argc > 1) {
+        iterations = strtoull(argv[1], nullptr, 10);
+    }
+
+    test_utils::run_test("Parse Request", test_parse_request);
+    test_utils::run_test("Keep-Alive", test_keep_alive);
+    test_utils::run_test("Body Length", test_body_length);
+    test_utils::run_test("Mixed Line Endings", test_mixed_line_endings);
+    test_utils::run_test("Differential", test_differential);
+
+    test_utils::print_test_summary();
+    return 0;
+}
@@ -0,0 +1,304 @@
+#include "../include/file_cache.h"
+#include "../include/hpack.h"
+#include "../include/http2.h"
+#include "test_utils.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct Frame {
+    uint8_t type;
+    uint8_t flags;
+    uint32_t stream_id;
+    std::string payload;
+};
+
+// Helper: serialize one frame
+static std::string frame(uint8_t type, uint8_t flags, uint32_t stream_id,
+                         const std::string &payload) {
+    std::string out;
+    uint32_t length = static_cast<uint32_t>(payload.size());
+    out += static_cast<char>(length >> 16);
+    out += static_cast<char>(length >> 8);
+    out += static_cast<char>(length);
+    out += static_cast<char>(type);
+    out += static_cast<char>(flags);
+    out += static_cast<char>(stream_id >> 24);
+    out += static_cast<char>(stream_id >> 16);
+    out += static_cast<char>(stream_id >> 8);
+    out += static_cast<char>(stream_id);
+    return out + payload;
+}
+
+// Helper: split produced bytes back into frames
+static std::vector<Frame> parse_frames(const std::string &data) {
+    std::vector<Frame> frames;
+    size_t pos = 0;
+    while (pos + 9 <= data.size()) {
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(data.data()) + pos;
+        uint32_t length = (p[0] << 16) | (p[1] << 8) | p[2];
+        Frame f;
+        f.type = p[3];
+        f.flags = p[4];
+        f.stream_id = ((p[5] & 0x7f) << 24) | (p[6] << 16) | (p[7] << 8) | p[8];
+        f.payload = data.substr(pos + 9, length);
+        frames.push_back(f);
+        pos += 9 + length;
+    }
+    return frames;
+}
+
+static std::string request_block(const std::string &path) {
+    std::string block;
+    hpack::encode_header(block, ":method", "GET");
+    hpack::encode_header(block, ":scheme", "http");
+    hpack::encode_header(block, ":path", path);
+    return block;
+}
+
+static std::string setting(uint16_t id, uint32_t value) {
+    std::string out;
+    out += static_cast<char>(id >> 8);
+    out += static_cast<char>(id);
+    out += static_cast<char>(value >> 24);
+    out += static_cast<char>(value >> 16);
+    out += static_cast<char>(value >> 8);
+    out += static_cast<char>(value);
+    return out;
+}
+
+static http2::RequestHandler body_handler(const std::string &body) {
+    std::shared_ptr<const CachedFile> file =
+        build_cached_file(200, "text/plain", body);
+    return [file](const HttpRequest &) { return file; };
+}
+
+// Test a full request/response exchange on one stream
+void test_simple_request() {
+    http2::Session session(body_handler("hello"));
+    std::string input(http2::CONNECTION_PREFACE,
+                      http2::CONNECTION_PREFACE_LENGTH);
+    input += frame(0x4, 0, 0, "");
+    input += frame(0x1, 0x5, 1, request_block("/hello.txt"));
+    test_utils::test_assert(session.receive(input.data(), input.size()),
+                            "Valid input should be accepted");
+
+    std::string out;
+    session.produce(out, 1 << 20);
+    std::vector<Frame> frames = parse_frames(out);
+    test_utils::test_assert(frames.size() == 4,
+                            "Expected SETTINGS, ACK, HEADERS and DATA");
+    test_utils::test_assert(frames[0].type == 0x4 && frames[0].flags == 0,
+                            "Server preface SETTINGS should come first");
+    test_utils::test_assert(
+        frames[0].payload.find(setting(0x6, 64 * 1024)) != std::string::npos,
+        "SETTINGS should advertise the header list limit");
+    test_utils::test_assert(frames[1].type == 0x4 && frames[1].flags == 0x1,
+                            "Client SETTINGS should be acknowledged");
+    test_utils::test_assert(frames[2].type == 0x1 && frames[2].stream_id == 1,
+                            "HEADERS should answer stream 1");
+    test_utils::test_assert(frames[3].type == 0x0 && frames[3].flags == 0x1 &&
+                                frames[3].payload == "hello",
+                            "DATA should carry the body and end the stream");
+
+    hpack::Decoder decoder;
+    hpack::HeaderList headers;
+    decoder.decode(reinterpret_cast<const uint8_t *>(frames[2].payload.data()),
+                   frames[2].payload.size(), headers);
+    test_utils::test_assert(headers.size() == 3 && headers[0].second == "200",
+                            "Pre-encoded headers should decode");
+    test_utils::test_assert(!session.has_output(),
+                            "Nothing should remain after the response");
+
+    // Like HTTP/1.1 parsing, the session drops the query
+    std::string seen;
+    http2::Session query([&seen](const HttpRequest &request) {
+        seen = request.path;
+        return build_cached_file(200, "text/plain", "q");
+    });
+    input.assign(http2::CONNECTION_PREFACE, http2::CONNECTION_PREFACE_LENGTH);
+    input += frame(0x1, 0x5, 1, request_block("/a.txt?v=2"));
+    query.receive(input.data(), input.size());
+    test_utils::test_assert(seen == "/a.txt",
+                            "The query should not reach the handler");
+}
+
+// Test that DATA respects the peer's stream window
+void test_flow_control() {
+    http2::Session session(body_handler(std::string(25, 'x')));
+    std::string input(http2::CONNECTION_PREFACE,
+                      http2::CONNECTION_PREFACE_LENGTH);
+    input += frame(0x4, 0, 0, setting(0x4, 10)); // INITIAL_WINDOW_SIZE
+    input += frame(0x1, 0x5, 1, request_block("/"));
+    session.receive(input.data(), input.size());
+
+    std::string out;
+    session.produce(out, 1 << 20);
+    std::vector<Frame> frames = parse_frames(out);
+    test_utils::test_assert(frames.back().type == 0x0 &&
+                                frames.back().payload.size() == 10 &&
+                                frames.back().flags == 0,
+                            "Only one window's worth of DATA may be sent");
+    test_utils::test_assert(!session.has_output(),
+                            "Stream should be blocked on its window");
+
+    std::string update = frame(0x8, 0, 1, std::string("\0\0\0\x0f", 4));
+    session.receive(update.data(), update.size());
+    out.clear();
+    session.produce(out, 1 << 20);
+    frames = parse_frames(out);
+    test_utils::test_assert(frames.size() == 1 &&
+                                frames[0].payload.size() == 15 &&
+                                frames[0].flags == 0x1,
+                            "WINDOW_UPDATE should release the rest");
+}
+
+// Test interleaving of concurrent streams
+void test_multiplexing() {
+    http2::Session session(body_handler(std::string(40000, 'y')));
+    std::string input(http2::CONNECTION_PREFACE,
+                      http2::CONNECTION_PREFACE_LENGTH);
+    input += frame(0x4, 0, 0, setting(0x4, 1 << 20));
+    input += frame(0x8, 0, 0, std::string("\0\x10\0\0", 4));
+    input += frame(0x1, 0x5, 1, request_block("/a"));
+    input += frame(0x1, 0x5, 3, request_block("/b"));
+    session.receive(input.data(), input.size());
+
+    std::string out;
+    session.produce(out, 1 << 20);
+    std::vector<uint32_t> data_streams;
+    std::vector<Frame> frames = parse_frames(out);
+    for (size_t i = 0; i < frames.size(); ++i) {
+        if (frames[i].type == 0x0) {
+            data_streams.push_back(frames[i].stream_id);
+        }
+    }
+    test_utils::test_assert(data_streams.size() == 6,
+                            "Each 40000-byte body needs three DATA frames");
+    test_utils::test_assert(data_streams[0] == 1 && data_streams[1] == 3 &&
+                                data_streams[2] == 1,
+                            "Streams should alternate frame by frame");
+}
+
+// Test control frames and protocol errors
+void test_control_and_errors() {
+    http2::Session session(body_handler(""));
+    std::string input(http2::CONNECTION_PREFACE,
+                      http2::CONNECTION_PREFACE_LENGTH);
+    input += frame(0x6, 0, 0, "12345678");
+    session.receive(input.data(), input.size());
+    std::string out;
+    session.produce(out, 1 << 20);
+    std::vector<Frame> frames = parse_frames(out);
+    test_utils::test_assert(frames.back().type == 0x6 &&
+                                frames.back().flags == 0x1 &&
+                                frames.back().payload == "12345678",
+                            "PING should be echoed with ACK");
+
+    std::string bad = frame(0x1, 0x5, 2, request_block("/"));
+    test_utils::test_assert(!session.receive(bad.data(), bad.size()),
+                            "Even client stream ids should be rejected");
+    out.clear();
+    session.produce(out, 1 << 20);
+    frames = parse_frames(out);
+    test_utils::test_assert(frames.size() == 1 && frames[0].type == 0x7,
+                            "A connection error should send GOAWAY");
+    test_utils::test_assert(session.is_closed(),
+                            "Session should be closed after GOAWAY");
+
+    http2::Session garbage(body_handler(""));
+    std::string junk = "GET / HTTP/1.1\r\n\r\n";
+    test_utils::test_assert(!garbage.receive(junk.data(), junk.size()),
+                            "A missing preface should be rejected");
+}
+
+// Test that a small block expanding past the header list limit is
+// refused: one 4KB dynamic entry referenced by one-byte indexes
+void test_header_list_limit() {
+    http2::Session session(body_handler(""));
+    std::string input(http2::CONNECTION_PREFACE,
+                      http2::CONNECTION_PREFACE_LENGTH);
+    input += frame(0x4, 0, 0, "");
+
+    std::string block = request_block("/");
+    block += static_cast<char>(0x40);
+    hpack::encode_string(block, "x");
+    hpack::encode_integer(block, 4000, 7, 0);
+    block += std::string(4000, 'a');
+    block += std::string(20000, static_cast<char>(0xbe));
+    input += frame(0x1, 0x1, 1, block.substr(0, 16000));
+    input += frame(0x9, 0x4, 1, block.substr(16000));
+    test_utils::test_assert(!session.receive(input.data(), input.size()),
+                            "An oversized header list should be refused");
+
+    std::string out;
+    session.produce(out, 1 << 20);
+    std::vector<Frame> frames = parse_frames(out);
+    test_utils::test_assert(!frames.empty() && frames.back().type == 0x7,
+                            "The connection should end with GOAWAY");
+    test_utils::test_assert(frames.size() == 3,
+                            "No response should be produced");
+}
+
+// Test that a peer flooding PINGs without reading the acks is cut off
+// instead of growing the pending control frames without bound
+void test_ping_flood() {
+    http2::Session session(body_handler(""));
+    std::string input(http2::CONNECTION_PREFACE,
+                      http2::CONNECTION_PREFACE_LENGTH);
+    session.receive(input.data(), input.size());
+
+    std::string ping = frame(0x6, 0, 0, "12345678");
+    bool accepted = true;
+    int sent = 0;
+    for (; sent < 100000 && accepted; ++sent) {
+        accepted = session.receive(ping.data(), ping.size());
+    }
+    test_utils::test_assert(!accepted && sent < 10000,
+                            "An unread PING flood should be refused");
+
+    std::string out;
+    session.produce(out, 1 << 20);
+    std::vector<Frame> frames = parse_frames(out);
+    test_utils::test_assert(out.size() < 80 * 1024 && !frames.empty() &&
+                                frames.back().type == 0x7 &&
+                                frames.back().payload.substr(4) ==
+                                    std::string("\0\0\0\x0b", 4),
+                            "The flood should end with ENHANCE_YOUR_CALM");
+    test_utils::test_assert(session.is_closed() &&
+                                !session.receive(ping.data(), ping.size()),
+                            "The session should stay closed");
+}
+
+// Test the h2c upgrade path answering stream 1
+void test_upgrade() {
+    http2::Session session(body_handler("up"));
+    HttpRequest request;
+    request.method = "GET";
+    request.path = "/";
+    test_utils::test_assert(
+        session.upgrade("AAMAAABkAAQCAAAAAAIAAAAA", request),
+        "Valid HTTP2-Settings should be accepted");
+    std::string out;
+    session.produce(out, 1 << 20);
+    std::vector<Frame> frames = parse_frames(out);
+    test_utils::test_assert(frames.size() == 3 && frames[1].stream_id == 1 &&
+                                frames[2].payload == "up",
+                            "The upgraded request should be answered");
+}
+
+int main() {
+    std::cout << "===== Running HTTP/2 Tests =====" << std::endl;
+
+    test_utils::run_test("Simple Request", test_simple_request);
+    test_utils::run_test("Flow Control", test_flow_control);
+    test_utils::run_test("Multiplexing", test_multiplexing);
+    test_utils::run_test("Control Frames and Errors", test_control_and_errors);
+    test_utils::run_test("Header List Limit", test_header_list_limit);
+    test_utils::run_test("PING Flood", test_ping_flood);
+    test_utils::run_test("h2c Upgrade", test_upgrade);
+
+    test_utils::print_test_summary();
+
+    return 0;
+}
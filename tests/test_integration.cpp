@@ -2,19 +2,27 @@
 #include "../include/file_utils.h"
 #include "../include/server.h"
 #include "test_utils.hpp"
+#include <algorithm>
 #include <arpa/inet.h>
-#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <dirent.h>
 #include <fcntl.h>
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <netinet/in.h>
 #include <string>
 #include <sys/socket.h>
+#include <sys/wait.h>
 #include <thread>
 #include <unistd.h>
+#include <vector>
 
 // Constants for testing
-const int TEST_PORT = 8082;
 const std::string TEST_DIR = "./test_public";
 const std::string TEST_FILE = "test_index.html";
 const std::string TEST_CONTENT = "<html><body>Test Content</body></html>";
@@ -23,13 +31,13 @@ const int SOCKET_TIMEOUT_SECONDS = 3;
 // Test fixture for integration tests
 class ServerIntegrationTest {
   public:
-    ServerIntegrationTest() : should_stop(false) {
+    ServerIntegrationTest() : port(0) {
         // Setup test environment
         test_utils::ensure_directory(TEST_DIR);
         test_utils::create_test_file(TEST_DIR + "/" + TEST_FILE, TEST_CONTENT);
 
-        // Configure server
-        config.port = TEST_PORT;
+        // Configure server; port 0 lets the kernel pick a free port
+        config.port = 0;
         config.root_directory = TEST_DIR;
     }
 
@@ -45,33 +53,30 @@ class ServerIntegrationTest {
         }
     }
 
-    // Start server in a separate thread with proper termination support
-    std::thread start_server() {
-        should_stop = false;
-        return std::thread([this]() {
+    // Start the server on its own thread; the listener is bound before
+    // this returns, so requests can follow immediately
+    void start_server() {
+        server.reset(new StaticFileServer(config));
+        port = server->local_port();
+        server_thread = std::thread([this]() {
             try {
-                StaticFileServer server(config);
-                server_started = true;
-
-                // In a real implementation, you would modify the server class
-                // to support graceful shutdown by checking the should_stop flag
-                while (!should_stop) {
-                    server.start();
-                    // Add a small delay to prevent CPU spinning
-                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                }
+                server->start();
             } catch (const std::exception &e) {
                 std::cerr << "Server error: " << e.what() << std::endl;
             }
         });
     }
 
-    // Stop the server gracefully
+    // Stop the server and wait for its event loop to return
     void stop_server() {
-        should_stop = true;
-
-        // Give the server thread time to clean up
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+        if (!server) {
+            return;
+        }
+        server->stop();
+        if (server_thread.joinable()) {
+            server_thread.join();
+        }
+        server.reset();
     }
 
     // Set socket timeout
@@ -109,7 +114,7 @@ class ServerIntegrationTest {
         struct sockaddr_in server_addr;
         memset(&server_addr, 0, sizeof(server_addr));
         server_addr.sin_family = AF_INET;
-        server_addr.sin_port = htons(TEST_PORT);
+        server_addr.sin_port = htons(static_cast<uint16_t>(port));
         inet_pton(AF_INET, "127.0.0.1", &server_addr.sin_addr);
 
         if (connect(sock, (struct sockaddr *)&server_addr,
@@ -148,8 +153,9 @@ class ServerIntegrationTest {
     }
 
     ServerConfig config;
-    std::atomic<bool> should_stop;
-    std::atomic<bool> server_started{false};
+    std::unique_ptr<StaticFileServer> server;
+    std::thread server_thread;
+    int port;
 };
 
 // Test for overall integration of components
@@ -216,10 +222,9 @@ void test_full_server_integration() {
     ServerIntegrationTest test_fixture;
 
     // Start server in background
-    std::thread server_thread = test_fixture.start_server();
-
-    // Allow server to initialize
-    std::this_thread::sleep_for(std::chrono::seconds(1));
+    test_fixture.start_server();
+    test_utils::test_assert(test_fixture.port > 0,
+                            "Server should report its ephemeral port");
 
     // Test existing file
     std::string response = test_fixture.make_request("/" + TEST_FILE);
@@ -237,9 +242,96 @@ void test_full_server_integration() {
 
     // Clean up - stop server and join thread
     test_fixture.stop_server();
-    if (server_thread.joinable()) {
-        server_thread.join();
+}
+
+// Helper: the live child processes of parent, from /proc
+static std::vector<pid_t> child_processes(pid_t parent) {
+    std::vector<pid_t> children;
+    DIR *proc = opendir("/proc");
+    if (proc == nullptr) {
+        return children;
+    }
+    while (struct dirent *entry = readdir(proc)) {
+        pid_t pid = static_cast<pid_t>(atoi(entry->d_name));
+        if (pid <= 0) {
+            continue;
+        }
+        // "pid (comm) state ppid ...", where comm may contain spaces
+        std::ifstream stat("/proc/" + std::string(entry->d_name) + "/stat");
+        std::string line;
+        std::getline(stat, line);
+        size_t close_paren = line.rfind(')');
+        if (close_paren == std::string::npos) {
+            continue;
+        }
+        char state = 0;
+        int ppid = 0;
+        if (sscanf(line.c_str() + close_paren + 1, " %c %d", &state,
+                   &ppid) == 2 &&
+            ppid == parent && state != 'Z') {
+            children.push_back(pid);
+        }
+    }
+    closedir(proc);
+    return children;
+}
+
+// Test that a killed worker process is replaced by one that serves, and
+// that stop() in another process does not reach the workers
+void test_prefork_respawn() {
+    ServerIntegrationTest test_fixture;
+    test_fixture.config.processes = 2;
+    test_fixture.config.shared_cache_size = 16 * 1024 * 1024;
+    test_fixture.server.reset(new StaticFileServer(test_fixture.config));
+    test_fixture.port = test_fixture.server->local_port();
+
+    pid_t master = fork();
+    if (master == 0) {
+        test_fixture.server->start();
+        _exit(0);
+    }
+
+    // Wait for both worker processes to be serving
+    std::vector<pid_t> workers;
+    for (int i = 0; i < 100 && workers.size() < 2; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        workers = child_processes(master);
+    }
+    test_utils::test_assert(workers.size() == 2,
+                            "The master should fork two workers");
+
+    // This process built the server before the fork; stopping its copy
+    // must leave the workers running
+    test_fixture.server->stop();
+
+    // Past the respawn backoff, so the replacement starts at once
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+    kill(workers[0], SIGKILL);
+    bool replaced = false;
+    for (int i = 0; i < 100 && !replaced; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::vector<pid_t> now = child_processes(master);
+        replaced = now.size() == 2 &&
+                   std::find(now.begin(), now.end(), workers[0]) == now.end();
+    }
+    test_utils::test_assert(replaced, "The killed worker should be replaced");
+
+    // Either process may accept; every request must be answered
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    int served = 0;
+    for (int i = 0; i < 20; ++i) {
+        std::string response = test_fixture.make_request("/" + TEST_FILE);
+        served += response.find(TEST_CONTENT) != std::string::npos;
     }
+    test_utils::test_assert(child_processes(master).size() == 2 &&
+                                served == 20,
+                            "Workers should keep serving after a respawn");
+
+    kill(master, SIGTERM);
+    int status = 0;
+    waitpid(master, &status, 0);
+    test_utils::test_assert(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+                            "The master should exit cleanly on SIGTERM");
 }
 
 int main() {
@@ -249,6 +341,7 @@ int main() {
     test_utils::run_test("Socket Creation", test_socket_creation);
     test_utils::run_test("Full Server Integration",
                          test_full_server_integration);
+    test_utils::run_test("Prefork Respawn", test_prefork_respawn);
 
     test_utils::print_test_summary();
 
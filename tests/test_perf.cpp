@@ -0,0 +1,352 @@
+#include "../include/config.h"
+#include "../include/server.h"
+#include "test_utils.hpp"
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <new>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+// Hot-path cost budgets. Each workload fails when the server thread
+// makes more syscalls or heap allocations per request than listed here;
+// tighten them when the hot path gets cheaper.
+namespace budget {
+// epoll_wait, recv twice (data, EAGAIN), fstatat to revalidate, send
+const double KEEP_ALIVE_SYSCALLS = 5.0;
+const double KEEP_ALIVE_ALLOCATIONS = 3.0;
+// The revalidating fstatat; reads and writes are shared by the batch
+const double PIPELINED_SYSCALLS = 1.25;
+const double PIPELINED_ALLOCATIONS = 3.0;
+// The failed open replaces fstatat
+const double NOT_FOUND_SYSCALLS = 5.0;
+const double NOT_FOUND_ALLOCATIONS = 3.0;
+// Accept to close, one request
+const double CONNECTION_SYSCALLS = 12.0;
+const double CONNECTION_ALLOCATIONS = 9.0;
+} // namespace budget
+
+// Counting is limited to threads that set this, i.e. the server's
+thread_local bool tracked = false;
+std::atomic<uint64_t> syscall_count(0);
+std::atomic<uint64_t> allocation_count(0);
+
+// The test binary defines these libc entry points, so the dynamic linker
+// binds the server's calls here (like an LD_PRELOAD shim); each forwards
+// to the next definition after counting.
+#define COUNTED(ret, name, params, args, spec)                                \
+    extern "C" ret name params spec {                                         \
+        typedef ret(*Real) params;                                            \
+        static Real real = reinterpret_cast<Real>(dlsym(RTLD_NEXT, #name));  \
+        if (tracked) {                                                        \
+            ++syscall_count;                                                  \
+        }                                                                     \
+        return real args;                                                     \
+    }
+
+COUNTED(int, accept4,
+        (int fd, struct sockaddr *addr, socklen_t *len, int flags),
+        (fd, addr, len, flags), )
+COUNTED(ssize_t, recv, (int fd, void *buf, size_t len, int flags),
+        (fd, buf, len, flags), )
+COUNTED(ssize_t, send, (int fd, const void *buf, size_t len, int flags),
+        (fd, buf, len, flags), )
+COUNTED(ssize_t, sendmsg, (int fd, const struct msghdr *msg, int flags),
+        (fd, msg, flags), )
+COUNTED(ssize_t, read, (int fd, void *buf, size_t len), (fd, buf, len), )
+COUNTED(ssize_t, write, (int fd, const void *buf, size_t len),
+        (fd, buf, len), )
+COUNTED(int, close, (int fd), (fd), )
+COUNTED(int, epoll_wait,
+        (int epfd, struct epoll_event *events, int max, int timeout),
+        (epfd, events, max, timeout), )
+COUNTED(int, epoll_ctl,
+        (int epfd, int op, int fd, struct epoll_event *event),
+        (epfd, op, fd, event), noexcept)
+COUNTED(int, fstat, (int fd, struct stat *st), (fd, st), noexcept)
+COUNTED(int, fstatat,
+        (int dirfd, const char *path, struct stat *st, int flags),
+        (dirfd, path, st, flags), noexcept)
+COUNTED(int, setsockopt,
+        (int fd, int level, int name, const void *value, socklen_t len),
+        (fd, level, name, value, len), noexcept)
+
+// Variadic: forwarded with the kernel's maximum of six arguments
+extern "C" long syscall(long number, ...) noexcept {
+    typedef long (*Real)(long, ...);
+    static Real real = reinterpret_cast<Real>(dlsym(RTLD_NEXT, "syscall"));
+    va_list args;
+    va_start(args, number);
+    long a[6];
+    for (int i = 0; i < 6; ++i) {
+        a[i] = va_arg(args, long);
+    }
+    va_end(args);
+    if (tracked) {
+        ++syscall_count;
+    }
+    return real(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+}
+
+extern "C" int openat(int dirfd, const char *path, int flags, ...) {
+    typedef int (*Real)(int, const char *, int, ...);
+    static Real real = reinterpret_cast<Real>(dlsym(RTLD_NEXT, "openat"));
+    va_list args;
+    va_start(args, flags);
+    mode_t mode = static_cast<mode_t>(va_arg(args, int));
+    va_end(args);
+    if (tracked) {
+        ++syscall_count;
+    }
+    return real(dirfd, path, flags, mode);
+}
+
+// Counting global allocation functions
+void *operator new(size_t size) {
+    if (tracked) {
+        ++allocation_count;
+    }
+    void *p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+namespace {
+const std::string ROOT = "./perf_public";
+const std::string SMALL_BODY = "<html><body>perf</body></html>";
+
+// In-process server on an ephemeral port, counted on its own thread
+class PerfServer {
+  public:
+    PerfServer() {
+        test_utils::ensure_directory(ROOT);
+        test_utils::create_test_file(ROOT + "/index.html", SMALL_BODY);
+        ServerConfig config;
+        config.port = 0;
+        config.root_directory = ROOT;
+        server.reset(new StaticFileServer(config));
+        port = server->local_port();
+        thread = std::thread([this]() {
+            tracked = true;
+            server->start();
+        });
+    }
+
+    ~PerfServer() {
+        server->stop();
+        thread.join();
+        server.reset();
+        test_utils::cleanup_test_file(ROOT + "/index.html");
+        rmdir(ROOT.c_str());
+    }
+
+    int connect_client() const {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in address;
+        memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(port));
+        inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0) {
+            ::close(fd);
+            return -1;
+        }
+        int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        struct timeval timeout = {5, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        return fd;
+    }
+
+    int port;
+
+  private:
+    std::unique_ptr<StaticFileServer> server;
+    std::thread thread;
+};
+
+// Reads until count complete responses (by Content-Length) have arrived
+bool read_responses(int fd, size_t count) {
+    std::string data;
+    size_t parsed = 0;
+    size_t offset = 0;
+    char buffer[65536];
+    while (parsed < count) {
+        size_t end = data.find("\r\n\r\n", offset);
+        if (end != std::string::npos) {
+            size_t length_at = data.find("Content-Length: ", offset);
+            size_t length = 0;
+            if (length_at != std::string::npos && length_at < end) {
+                length = strtoul(data.c_str() + length_at + 16, nullptr, 10);
+            }
+            if (data.size() >= end + 4 + length) {
+                offset = end + 4 + length;
+                ++parsed;
+                continue;
+            }
+        }
+        ssize_t got = ::recv(fd, buffer, sizeof(buffer), 0);
+        if (got <= 0) {
+            return false;
+        }
+        data.append(buffer, static_cast<size_t>(got));
+    }
+    return true;
+}
+
+struct Cost {
+    double syscalls;
+    double allocations;
+};
+
+// Runs workload once to warm caches, then again while counting
+template <typename Workload>
+Cost measure(Workload workload, size_t requests) {
+    workload();
+    // Let the server go back to epoll_wait before the baseline
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    uint64_t syscalls = syscall_count.load();
+    uint64_t allocations = allocation_count.load();
+    workload();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    Cost cost;
+    cost.syscalls = static_cast<double>(syscall_count.load() - syscalls) /
+                    static_cast<double>(requests);
+    cost.allocations =
+        static_cast<double>(allocation_count.load() - allocations) /
+        static_cast<double>(requests);
+    return cost;
+}
+
+void check(const char *name, const Cost &cost, double syscall_budget,
+           double allocation_budget) {
+    std::cout << "  " << name << ": " << cost.syscalls << " syscalls, "
+              << cost.allocations << " allocations per request" << std::endl;
+    test_utils::test_assert(cost.syscalls <= syscall_budget,
+                            std::string(name) + " syscalls over budget");
+    test_utils::test_assert(cost.allocations <= allocation_budget,
+                            std::string(name) + " allocations over budget");
+}
+
+const size_t REQUESTS = 200;
+const std::string GET_INDEX = "GET /index.html HTTP/1.1\r\nHost: x\r\n\r\n";
+} // namespace
+
+// Test one request at a time on a kept-alive connection
+void test_keep_alive() {
+    PerfServer server;
+    int fd = server.connect_client();
+    bool ok = fd >= 0;
+    Cost cost = measure(
+        [&]() {
+            for (size_t i = 0; ok && i < REQUESTS; ++i) {
+                ok = ::send(fd, GET_INDEX.data(), GET_INDEX.size(), 0) > 0 &&
+                     read_responses(fd, 1);
+            }
+        },
+        REQUESTS);
+    ::close(fd);
+    test_utils::test_assert(ok, "Every request should get a response");
+    check("keep-alive hit", cost, budget::KEEP_ALIVE_SYSCALLS,
+          budget::KEEP_ALIVE_ALLOCATIONS);
+}
+
+// Test a batch of pipelined requests written at once
+void test_pipelined() {
+    PerfServer server;
+    int fd = server.connect_client();
+    std::string batch;
+    for (size_t i = 0; i < REQUESTS; ++i) {
+        batch += GET_INDEX;
+    }
+    bool ok = fd >= 0;
+    Cost cost = measure(
+        [&]() {
+            ok = ok && ::send(fd, batch.data(), batch.size(), 0) > 0 &&
+                 read_responses(fd, REQUESTS);
+        },
+        REQUESTS);
+    ::close(fd);
+    test_utils::test_assert(ok, "Every request should get a response");
+    check("pipelined hit", cost, budget::PIPELINED_SYSCALLS,
+          budget::PIPELINED_ALLOCATIONS);
+}
+
+// Test misses, which go to the file system every time
+void test_not_found() {
+    PerfServer server;
+    int fd = server.connect_client();
+    std::string request = "GET /missing.html HTTP/1.1\r\nHost: x\r\n\r\n";
+    bool ok = fd >= 0;
+    Cost cost = measure(
+        [&]() {
+            for (size_t i = 0; ok && i < REQUESTS; ++i) {
+                ok = ::send(fd, request.data(), request.size(), 0) > 0 &&
+                     read_responses(fd, 1);
+            }
+        },
+        REQUESTS);
+    ::close(fd);
+    test_utils::test_assert(ok, "Every request should get a response");
+    check("not found", cost, budget::NOT_FOUND_SYSCALLS,
+          budget::NOT_FOUND_ALLOCATIONS);
+}
+
+// Test a new connection per request
+void test_connection_per_request() {
+    PerfServer server;
+    std::string request =
+        "GET /index.html HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n";
+    bool ok = true;
+    const size_t connections = 50;
+    Cost cost = measure(
+        [&]() {
+            for (size_t i = 0; ok && i < connections; ++i) {
+                int fd = server.connect_client();
+                ok = fd >= 0 &&
+                     ::send(fd, request.data(), request.size(), 0) > 0 &&
+                     read_responses(fd, 1);
+                char byte;
+                ok = ok && ::recv(fd, &byte, 1, 0) == 0; // Server closes
+                ::close(fd);
+            }
+        },
+        connections);
+    test_utils::test_assert(ok, "Every connection should be answered");
+    check("connection per request", cost, budget::CONNECTION_SYSCALLS,
+          budget::CONNECTION_ALLOCATIONS);
+}
+
+int main() {
+    std::cout << "===== Running Performance Budget Tests =====" << std::endl;
+
+    test_utils::run_test("Keep-Alive Requests", test_keep_alive);
+    test_utils::run_test("Pipelined Requests", test_pipelined);
+    test_utils::run_test("Not Found", test_not_found);
+    test_utils::run_test("Connection Per Request",
+                         test_connection_per_request);
+
+    test_utils::print_test_summary();
+
+    return 0;
+}
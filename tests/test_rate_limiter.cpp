@@ -0,0 +1,231 @@
+#include "../include/rate_limiter.h"
+#include "test_utils.hpp"
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/un.h>
+#include <thread>
+#include <vector>
+
+// Helper: build a client address from an IPv4 string
+static ClientAddress ipv4(const char *ip) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    inet_pton(AF_INET, ip, &addr.sin_addr);
+    return client_address_from((struct sockaddr *)&addr);
+}
+
+// Test that the limiter is inert by default
+void test_disabled_by_default() {
+    RateLimitConfig config;
+    RateLimiter limiter(config);
+    test_utils::test_assert(!limiter.enabled(),
+                            "Limiter should be disabled without limits");
+    ClientAddress client = ipv4("192.0.2.1");
+    for (int i = 0; i < 1000; ++i) {
+        test_utils::test_assert(limiter.allow_request(client),
+                                "Disabled limiter should allow everything");
+    }
+}
+
+// Test request bursts and lazy refill
+void test_request_bucket() {
+    RateLimitConfig config;
+    config.requests_per_second = 100;
+    config.request_burst = 5;
+    RateLimiter limiter(config);
+    ClientAddress client = ipv4("192.0.2.1");
+
+    for (int i = 0; i < 5; ++i) {
+        test_utils::test_assert(limiter.allow_request(client),
+                                "Requests within the burst should pass");
+    }
+    test_utils::test_assert(!limiter.allow_request(client),
+                            "Requests beyond the burst should be refused");
+    test_utils::test_assert(limiter.allow_request(ipv4("198.51.100.7")),
+                            "Other clients should be unaffected");
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    test_utils::test_assert(limiter.allow_request(client),
+                            "Tokens should refill over time");
+}
+
+// Test that a /24 shares a budget larger than one address
+void test_prefix_bucket() {
+    RateLimitConfig config;
+    config.requests_per_second = 0.001;
+    config.request_burst = 2;
+    config.prefix_multiplier = 2; // The /24 gets 4 requests
+    RateLimiter limiter(config);
+
+    int allowed = 0;
+    for (int host = 1; host <= 4; ++host) {
+        std::string ip = "203.0.113." + std::to_string(host);
+        for (int i = 0; i < 2; ++i) {
+            allowed += limiter.allow_request(ipv4(ip.c_str())) ? 1 : 0;
+        }
+    }
+    test_utils::test_assert(allowed == 4,
+                            "The prefix budget should cap the whole /24");
+}
+
+// Test per-address connection caps
+void test_connection_cap() {
+    RateLimitConfig config;
+    config.max_connections = 2;
+    RateLimiter limiter(config);
+    ClientAddress client = ipv4("192.0.2.9");
+    RateLimiter::Admission first, second, third;
+
+    test_utils::test_assert(limiter.admit_connection(client, first) &&
+                                limiter.admit_connection(client, second),
+                            "Connections under the cap should be admitted");
+    test_utils::test_assert(!limiter.admit_connection(client, third),
+                            "Connections over the cap should be refused");
+    limiter.release_connection(client, first);
+    test_utils::test_assert(limiter.admit_connection(client, third),
+                            "Released slots should be reusable");
+}
+
+// Test that a connection admitted without being counted, because its
+// probe window was full of open connections, releases nothing
+void test_uncounted_release() {
+    RateLimitConfig config;
+    config.max_connections = 1;
+    config.table_size = 16;
+    RateLimiter limiter(config);
+
+    // Hold connections from distinct /24s until one fails open
+    std::vector<ClientAddress> held;
+    std::vector<RateLimiter::Admission> admissions;
+    ClientAddress client;
+    RateLimiter::Admission uncounted;
+    bool found = false;
+    for (int i = 0; i < 5000 && !found; ++i) {
+        std::string ip = "10." + std::to_string(i / 256 % 256) + "." +
+                         std::to_string(i % 256) + ".1";
+        client = ipv4(ip.c_str());
+        RateLimiter::Admission admission;
+        limiter.admit_connection(client, admission);
+        if (!admission.address) {
+            uncounted = admission;
+            found = true;
+        } else {
+            held.push_back(client);
+            admissions.push_back(admission);
+        }
+    }
+    test_utils::test_assert(found, "A full table should fail open");
+    for (size_t i = 0; i < held.size(); ++i) {
+        limiter.release_connection(held[i], admissions[i]);
+    }
+
+    RateLimiter::Admission counted, extra;
+    test_utils::test_assert(limiter.admit_connection(client, counted) &&
+                                counted.address,
+                            "Freed slots should count the client again");
+    limiter.release_connection(client, uncounted);
+    test_utils::test_assert(!limiter.admit_connection(client, extra),
+                            "An uncounted release should not free a slot");
+}
+
+// Test bandwidth debt
+void test_byte_bucket() {
+    RateLimitConfig config;
+    config.bytes_per_second = 1000;
+    config.byte_burst = 4096;
+    RateLimiter limiter(config);
+    ClientAddress client = ipv4("192.0.2.3");
+
+    test_utils::test_assert(limiter.charge_bytes(client, 4000),
+                            "Bytes within the burst should be fine");
+    test_utils::test_assert(!limiter.charge_bytes(client, 4000),
+                            "Going into debt should be reported");
+}
+
+// Test that a table full of drained entries still limits new clients
+void test_table_pressure() {
+    RateLimitConfig config;
+    config.requests_per_second = 0.001;
+    config.request_burst = 1;
+    config.table_size = 16;
+    RateLimiter limiter(config);
+
+    for (int i = 0; i < 5000; ++i) {
+        std::string ip = "10." + std::to_string(i / 256 % 256) + "." +
+                         std::to_string(i % 256) + ".1";
+        limiter.allow_request(ipv4(ip.c_str()));
+    }
+    ClientAddress fresh = ipv4("172.16.0.1");
+    test_utils::test_assert(limiter.allow_request(fresh),
+                            "A new client should get an entry");
+    test_utils::test_assert(!limiter.allow_request(fresh),
+                            "A full table should still limit it");
+}
+
+// Test that a client in debt that keeps coming back is not evicted by
+// a stream of new ones
+void test_debt_survives_pressure() {
+    RateLimitConfig config;
+    config.requests_per_second = 0.001;
+    config.request_burst = 1;
+    config.table_size = 16;
+    RateLimiter limiter(config);
+    ClientAddress client = ipv4("192.0.2.1");
+
+    test_utils::test_assert(limiter.allow_request(client) &&
+                                !limiter.allow_request(client),
+                            "The client should drain its bucket");
+    for (int i = 0; i < 5000; ++i) {
+        std::string ip = "10." + std::to_string(i / 256 % 256) + "." +
+                         std::to_string(i % 256) + ".1";
+        limiter.allow_request(ipv4(ip.c_str()));
+        if (i % 8 == 0) {
+            limiter.allow_request(client);
+        }
+    }
+    test_utils::test_assert(!limiter.allow_request(client),
+                            "Table pressure should not reset the budget");
+}
+
+// Test that Unix socket peers do not share one limited bucket
+void test_local_peers() {
+    RateLimitConfig config;
+    config.requests_per_second = 0.001;
+    config.request_burst = 1;
+    config.max_connections = 1;
+    RateLimiter limiter(config);
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    ClientAddress local = client_address_from((struct sockaddr *)&addr);
+    for (int i = 0; i < 10; ++i) {
+        RateLimiter::Admission admission;
+        test_utils::test_assert(limiter.admit_connection(local, admission) &&
+                                    limiter.allow_request(local),
+                                "Local peers should not be limited");
+    }
+}
+
+int main() {
+    std::cout << "===== Running Rate Limiter Tests =====" << std::endl;
+
+    test_utils::run_test("Disabled By Default", test_disabled_by_default);
+    test_utils::run_test("Request Bucket", test_request_bucket);
+    test_utils::run_test("Prefix Bucket", test_prefix_bucket);
+    test_utils::run_test("Connection Cap", test_connection_cap);
+    test_utils::run_test("Uncounted Release", test_uncounted_release);
+    test_utils::run_test("Byte Bucket", test_byte_bucket);
+    test_utils::run_test("Table Pressure", test_table_pressure);
+    test_utils::run_test("Debt Survives Pressure",
+                         test_debt_survives_pressure);
+    test_utils::run_test("Local Peers", test_local_peers);
+
+    test_utils::print_test_summary();
+
+    return 0;
+}
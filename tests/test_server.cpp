@@ -1,12 +1,22 @@
 #include "../include/config.h"
 #include "../include/server.h"
 #include "test_utils.hpp"
+#include <cstring>
+#include <fcntl.h>
 #include <iostream>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sched.h>
 #include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 // Mock class to test StaticFileServer functionality
 class TestableStaticFileServer : public StaticFileServer {
   public:
+    using StaticFileServer::Listener;
+
     TestableStaticFileServer(const ServerConfig &config)
         : StaticFileServer(config) {}
 
@@ -29,7 +39,63 @@ class TestableStaticFileServer : public StaticFileServer {
     void test_initialize_mime_types() { 
         initialize_mime_types(); 
     }
+
+    const std::vector<Listener> &test_listeners() const { return listeners; }
+
+    std::string test_host_root(const std::string &host_header) {
+        return select_host(host_header).config.root_directory;
+    }
+
+    // Hands raw request bytes to an HTTP/1.1 connection on a socketpair
+    // and returns what it writes back; open reports keep-alive
+    std::string test_exchange(const std::string &input, bool &open) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+            return "";
+        }
+        fcntl(fds[0], F_SETFL, O_NONBLOCK);
+        Worker worker;
+        worker.id = 0;
+        worker.node = -1;
+        worker.replica = 0;
+        worker.epoll_fd = epoll_create1(0);
+        worker.counters = &control->counters[0];
+        worker.accepted = 0;
+        Connection conn;
+        conn.worker = &worker;
+        conn.fd = fds[0];
+        conn.events = 0;
+        conn.input = input;
+        conn.output_offset = 0;
+        conn.close_after_write = false;
+        conn.body_remaining = 0;
+        conn.address = ClientAddress();
+        conn.paced = false;
+        open = handle_http1(conn) && flush_connection(conn);
+
+        close(fds[0]);
+        std::string output;
+        char buffer[4096];
+        ssize_t got;
+        while ((got = read(fds[1], buffer, sizeof(buffer))) > 0) {
+            output.append(buffer, static_cast<size_t>(got));
+        }
+        close(fds[1]);
+        close(worker.epoll_fd);
+        return output;
+    }
 };
+
+namespace {
+size_t count_of(const std::string &text, const std::string &needle) {
+    size_t count = 0;
+    for (size_t at = text.find(needle); at != std::string::npos;
+         at = text.find(needle, at + 1)) {
+        ++count;
+    }
+    return count;
+}
+} // namespace
 // Test server initialization
 void test_server_init() {
     ServerConfig config;
@@ -102,12 +168,234 @@ void test_server_config() {
     }
 }
 
+// Test IPv4, IPv6 and Unix listeners with per-listener options
+void test_multiple_listeners() {
+    ServerConfig config;
+    ListenerConfig v4;
+    v4.address = "127.0.0.1";
+    v4.port = 0;
+    v4.defer_accept = 5;
+    v4.send_buffer = 256 * 1024;
+    config.listeners.push_back(v4);
+
+    ListenerConfig v6;
+    v6.address = "::1";
+    v6.port = 0;
+    v6.v6_only = true;
+    config.listeners.push_back(v6);
+
+    ListenerConfig local;
+    local.address = "unix:./test_server.sock";
+    config.listeners.push_back(local);
+
+    {
+        TestableStaticFileServer server(config);
+        const std::vector<TestableStaticFileServer::Listener> &listeners =
+            server.test_listeners();
+        test_utils::test_assert(listeners.size() == 3,
+                                "All configured listeners should be open");
+
+        struct sockaddr_storage addr;
+        socklen_t length = sizeof(addr);
+        getsockname(listeners[1].fd, (struct sockaddr *)&addr, &length);
+        test_utils::test_assert(addr.ss_family == AF_INET6,
+                                "The second listener should be IPv6");
+        test_utils::test_assert(system("test -S ./test_server.sock") == 0,
+                                "The Unix socket should exist while listening");
+    }
+    test_utils::test_assert(system("test -e ./test_server.sock") != 0,
+                            "The Unix socket should be removed on shutdown");
+
+    // Bad addresses are reported at startup
+    ServerConfig bad;
+    ListenerConfig invalid;
+    invalid.address = "not-an-address";
+    bad.listeners.push_back(invalid);
+    bool threw = false;
+    try {
+        TestableStaticFileServer server(bad);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    test_utils::test_assert(threw, "Invalid listen addresses should throw");
+}
+
+// Test that reuseport gives each worker its own socket on one port, and
+// that CPU steering hands a connection to the receiving CPU's worker
+void test_reuseport() {
+    ServerConfig config;
+    config.workers = 2;
+    ListenerConfig steered;
+    steered.address = "127.0.0.1";
+    steered.port = 0;
+    steered.reuseport = "cpu";
+    config.listeners.push_back(steered);
+    TestableStaticFileServer server(config);
+    const std::vector<TestableStaticFileServer::Listener> &listeners =
+        server.test_listeners();
+    test_utils::test_assert(listeners.size() == 2 &&
+                                listeners[0].worker == 0 &&
+                                listeners[1].worker == 1,
+                            "Each worker should get a socket");
+    int port = server.local_port();
+
+    // Loopback connections are received on the connecting CPU
+    cpu_set_t saved;
+    sched_getaffinity(0, sizeof(saved), &saved);
+    int cpu = sched_getcpu();
+    cpu_set_t pinned;
+    CPU_ZERO(&pinned);
+    CPU_SET(cpu, &pinned);
+    sched_setaffinity(0, sizeof(pinned), &pinned);
+
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bool connected =
+        connect(client, (struct sockaddr *)&address, sizeof(address)) == 0;
+    sched_setaffinity(0, sizeof(saved), &saved);
+
+    struct pollfd fds[2];
+    for (int i = 0; i < 2; ++i) {
+        fds[i].fd = listeners[i].fd;
+        fds[i].events = POLLIN;
+        fds[i].revents = 0;
+    }
+    poll(fds, 2, 1000);
+    close(client);
+    test_utils::test_assert(connected, "The shared port should accept");
+    test_utils::test_assert(fds[cpu % 2].revents != 0 &&
+                                fds[1 - cpu % 2].revents == 0,
+                            "The receiving CPU should pick the socket");
+}
+
+// Test Host header routing to virtual hosts
+void test_virtual_hosts() {
+    ServerConfig config;
+    config.port = 0;
+    config.root_directory = "./default_public";
+    VirtualHostConfig site;
+    site.server_names.push_back("Example.test");
+    site.server_names.push_back("[::1]");
+    site.root_directory = "./site_public";
+    config.virtual_hosts.push_back(site);
+
+    TestableStaticFileServer server(config);
+    test_utils::test_assert(server.test_host_root("example.test") ==
+                                "./site_public",
+                            "Server names should select their host");
+    test_utils::test_assert(server.test_host_root("EXAMPLE.test:8080") ==
+                                "./site_public",
+                            "Host matching should ignore case and port");
+    test_utils::test_assert(server.test_host_root("[::1]:8080") ==
+                                "./site_public",
+                            "Bracketed IPv6 hosts should drop the port");
+    test_utils::test_assert(server.test_host_root("other.test") ==
+                                "./default_public",
+                            "Unknown hosts should use the default host");
+    test_utils::test_assert(server.test_host_root("") == "./default_public",
+                            "Requests without Host should use the default");
+
+    // The same name on two hosts is a configuration error
+    config.virtual_hosts.push_back(site);
+    bool threw = false;
+    try {
+        TestableStaticFileServer duplicate(config);
+    } catch (const std::runtime_error &) {
+        threw = true;
+    }
+    test_utils::test_assert(threw, "Duplicate server names should throw");
+}
+
+// Test keep-alive, pipelining and Connection: close on HTTP/1.x
+void test_pipelining() {
+    ServerConfig config;
+    config.port = 0;
+    config.root_directory = "./pipeline_public"; // Missing: every GET is 404
+    TestableStaticFileServer server(config);
+
+    bool open = false;
+    std::string output = server.test_exchange(
+        "GET /a HTTP/1.1\r\nHost: x\r\n\r\n"
+        "GET /b HTTP/1.1\r\nHost: x\r\n\r\nGET /c HT",
+        open);
+    test_utils::test_assert(count_of(output, "HTTP/1.1 404") == 2,
+                            "Pipelined requests should all be answered");
+    test_utils::test_assert(open && output.find("Connection:") ==
+                                        std::string::npos,
+                            "HTTP/1.1 connections should stay open");
+
+    output = server.test_exchange(
+        "GET /a HTTP/1.1\r\nConnection: Close\r\n\r\n"
+        "GET /b HTTP/1.1\r\n\r\n",
+        open);
+    test_utils::test_assert(count_of(output, "HTTP/1.1 404") == 1 && !open,
+                            "Connection: close should end the connection");
+    test_utils::test_assert(
+        output.find("Connection: close\r\n\r\nNot Found") !=
+            std::string::npos,
+        "Closing responses should say so in their header");
+
+    output = server.test_exchange("GET /a HTTP/1.0\r\n\r\n", open);
+    test_utils::test_assert(!open && count_of(output, "404") == 1,
+                            "HTTP/1.0 connections should close");
+}
+
+// Test that request bodies are never parsed as pipelined requests
+void test_request_bodies() {
+    ServerConfig config;
+    config.port = 0;
+    config.root_directory = "./pipeline_public";
+    TestableStaticFileServer server(config);
+
+    bool open = false;
+    std::string output = server.test_exchange(
+        "POST / HTTP/1.1\r\nHost: x\r\nContent-Length: 28\r\n\r\n"
+        "GET /secret.txt HTTP/1.1\r\n\r\n",
+        open);
+    test_utils::test_assert(count_of(output, "HTTP/1.1 ") == 1 &&
+                                count_of(output, "HTTP/1.1 405") == 1,
+                            "A body should not be answered as a request");
+    test_utils::test_assert(open, "A skipped body should keep the connection");
+
+    output = server.test_exchange(
+        "POST / HTTP/1.1\r\nContent-Length: 5\r\n\r\nhello"
+        "GET /a HTTP/1.1\r\n\r\n",
+        open);
+    test_utils::test_assert(count_of(output, "HTTP/1.1 405") == 1 &&
+                                count_of(output, "HTTP/1.1 404") == 1,
+                            "The request after a body should be answered");
+
+    output = server.test_exchange(
+        "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+        "0\r\n\r\nGET /a HTTP/1.1\r\n\r\n",
+        open);
+    test_utils::test_assert(count_of(output, "HTTP/1.1 ") == 1 &&
+                                count_of(output, "HTTP/1.1 400") == 1 && !open,
+                            "Transfer-Encoding should be refused and close");
+
+    output = server.test_exchange(
+        "POST / HTTP/1.1\r\nContent-Length: 1\r\nContent-Length: 2\r\n"
+        "\r\nGET /a HTTP/1.1\r\n\r\n",
+        open);
+    test_utils::test_assert(count_of(output, "HTTP/1.1 400") == 1 && !open,
+                            "Conflicting lengths should be refused");
+}
+
 int main() {
     std::cout << "===== Running Server Tests =====" << std::endl;
 
     test_utils::run_test("Server Initialization", test_server_init);
     test_utils::run_test("MIME Type Detection", test_mime_types);
     test_utils::run_test("Server Configuration", test_server_config);
+    test_utils::run_test("Multiple Listeners", test_multiple_listeners);
+    test_utils::run_test("Reuseport", test_reuseport);
+    test_utils::run_test("Virtual Hosts", test_virtual_hosts);
+    test_utils::run_test("Pipelining", test_pipelining);
+    test_utils::run_test("Request Bodies", test_request_bodies);
 
     test_utils::print_test_summary();
 
@@ -0,0 +1,175 @@
+#include "../include/shared_cache.h"
+#include "../include/content_store.h"
+#include "test_utils.hpp"
+#include <iostream>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+std::shared_ptr<CachedFile> make_file(const std::string &body) {
+    hpack::HeaderList headers;
+    headers.push_back(hpack::Header("Cache-Control", "max-age=60"));
+    std::shared_ptr<CachedFile> file =
+        build_cached_file(200, "text/plain", body, headers);
+    file->device = 7;
+    file->inode = 42;
+    file->size = static_cast<off_t>(body.size());
+    file->mtime.tv_sec = 1000;
+    file->mtime.tv_nsec = 5;
+    file->stale_at = 0;
+    file->gzip_variant = true;
+    return file;
+}
+} // namespace
+
+// Test that a stored response reads back with every field intact
+void test_roundtrip() {
+    SharedCache cache(1024 * 1024, false);
+    std::shared_ptr<CachedFile> file = make_file("hello shared");
+    std::shared_ptr<const CachedFile> stored = cache.insert("*\n/a", *file);
+    std::shared_ptr<const CachedFile> found = cache.find("*\n/a");
+
+    test_utils::test_assert(stored && found, "Inserted keys should be found");
+    test_utils::test_assert(
+        std::string(found->body.data(), found->body.size()) == "hello shared",
+        "The body should round-trip");
+    test_utils::test_assert(found->http1_header == file->http1_header &&
+                                found->hpack_header == file->hpack_header &&
+                                found->content_type == "text/plain",
+                            "Prepared headers should round-trip");
+    test_utils::test_assert(
+        std::string(found->packet.data(), found->packet.size()) ==
+                file->http1_header + "hello shared" &&
+            found->packet.data() == stored->packet.data(),
+        "Small responses should find their packet in the segment");
+    test_utils::test_assert(found->inode == 42 && found->device == 7 &&
+                                found->mtime.tv_nsec == 5 &&
+                                found->gzip_variant,
+                            "File identity should round-trip");
+    test_utils::test_assert(found->body.data() == stored->body.data(),
+                            "Lookups should share one copy of the body");
+    test_utils::test_assert(!cache.find("*\n/b"),
+                            "Unknown keys should miss");
+}
+
+// Test that inserting a key again replaces what lookups see
+void test_replace() {
+    SharedCache cache(1024 * 1024, false);
+    cache.insert("*\n/a", *make_file("old"));
+    std::shared_ptr<const CachedFile> old = cache.find("*\n/a");
+    cache.insert("*\n/a", *make_file("new"));
+    std::shared_ptr<const CachedFile> found = cache.find("*\n/a");
+    test_utils::test_assert(
+        std::string(found->body.data(), found->body.size()) == "new",
+        "The latest insert should win");
+    test_utils::test_assert(std::string(old->body.data(), 3) == "old",
+                            "Earlier records should stay readable");
+}
+
+// Test that a full segment refuses inserts instead of overwriting
+void test_full() {
+    SharedCache cache(256 * 1024, false);
+    std::string body(64 * 1024, 'x');
+    size_t stored = 0;
+    for (int i = 0; i < 10; ++i) {
+        if (cache.insert("*\n/" + std::to_string(i), *make_file(body))) {
+            ++stored;
+        }
+    }
+    test_utils::test_assert(stored > 0 && stored < 10,
+                            "Inserts should stop when the segment is full");
+    test_utils::test_assert(cache.find("*\n/0") && !cache.find("*\n/9"),
+                            "Stored entries should survive a failed insert");
+    test_utils::test_assert(cache.used_bytes() <= cache.capacity(),
+                            "Usage should not exceed the segment");
+}
+
+// Test that entries with the same bytes share one body in the segment
+void test_dedup() {
+    SharedCache cache(1024 * 1024, false);
+    std::string body(20000, 'd');
+    std::shared_ptr<CachedFile> file = make_file(body);
+    file->content_hash = content_hash(body.data(), body.size());
+    std::shared_ptr<const CachedFile> a = cache.insert("*\n/a.js", *file);
+    size_t used = cache.used_bytes();
+    std::shared_ptr<const CachedFile> b = cache.insert("x\n/b.js", *file);
+    test_utils::test_assert(a && b && a->body.data() == b->body.data(),
+                            "Identical bodies should be stored once");
+    test_utils::test_assert(cache.used_bytes() - used < 4096,
+                            "The second entry should only add headers");
+    test_utils::test_assert(b->content_hash == file->content_hash,
+                            "The content hash should round-trip");
+
+    // A small shared body follows only its first header, so other
+    // entries rebuild their packet locally
+    std::shared_ptr<CachedFile> small = make_file("small body");
+    small->content_hash = content_hash("small body", 10);
+    std::shared_ptr<const CachedFile> c = cache.insert("*\n/c.js", *small);
+    std::shared_ptr<const CachedFile> d = cache.insert("x\n/d.js", *small);
+    test_utils::test_assert(c && d && c->body.data() == d->body.data(),
+                            "Small bodies should be deduplicated too");
+    test_utils::test_assert(
+        c->packet.data() + c->http1_header.size() == c->body.data() &&
+            std::string(d->packet.data(), d->packet.size()) ==
+                d->http1_header + "small body",
+        "Each entry should still get its packet");
+}
+
+// Test that a forked process sees the parent's entries and vice versa
+void test_cross_process() {
+    SharedCache cache(1024 * 1024, false);
+    cache.insert("*\n/parent", *make_file("from parent"));
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        std::shared_ptr<const CachedFile> found = cache.find("*\n/parent");
+        bool ok = found && std::string(found->body.data(),
+                                       found->body.size()) == "from parent";
+        ok = ok && cache.insert("*\n/child", *make_file("from child"));
+        _exit(ok ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    test_utils::test_assert(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+                            "The child should see the parent's entry");
+    std::shared_ptr<const CachedFile> found = cache.find("*\n/child");
+    test_utils::test_assert(
+        found &&
+            std::string(found->body.data(), found->body.size()) == "from child",
+        "The parent should see the child's entry");
+}
+
+// Test that erased keys miss, by exact key or by prefix
+void test_erase() {
+    SharedCache cache(1024 * 1024, false);
+    cache.insert("*\n/css/a.css", *make_file("a"));
+    cache.insert("*\n/css/b.css", *make_file("b"));
+    cache.insert("*\n/index.html", *make_file("i"));
+
+    test_utils::test_assert(cache.erase("*\n/index.html", false) == 1 &&
+                                !cache.find("*\n/index.html"),
+                            "An erased key should miss");
+    test_utils::test_assert(cache.erase("*\n/css/", true) == 2 &&
+                                !cache.find("*\n/css/a.css") &&
+                                !cache.find("*\n/css/b.css"),
+                            "A prefix should erase every matching key");
+    test_utils::test_assert(cache.insert("*\n/index.html", *make_file("j")) &&
+                                cache.find("*\n/index.html"),
+                            "Erased keys can be inserted again");
+}
+
+int main() {
+    std::cout << "===== Running Shared Cache Tests =====" << std::endl;
+
+    test_utils::run_test("Round Trip", test_roundtrip);
+    test_utils::run_test("Replace", test_replace);
+    test_utils::run_test("Full Segment", test_full);
+    test_utils::run_test("Deduplication", test_dedup);
+    test_utils::run_test("Cross Process", test_cross_process);
+    test_utils::run_test("Erase", test_erase);
+
+    test_utils::print_test_summary();
+
+    return 0;
+}
@@ -0,0 +1,62 @@
+#include "../include/trace.h"
+#include "test_utils.hpp"
+#include <iostream>
+#include <string>
+#include <thread>
+
+static size_t count(const std::string &text, const std::string &needle) {
+    size_t found = 0;
+    for (size_t pos = text.find(needle); pos != std::string::npos;
+         pos = text.find(needle, pos + 1)) {
+        ++found;
+    }
+    return found;
+}
+
+// Test that recorded phases from several threads reach the JSON dump
+void test_dump() {
+    trace::record(trace::READ, 7, trace::now(), trace::now());
+    std::thread other([]() {
+        trace::Scope scope(trace::LOOKUP, 9);
+    });
+    other.join();
+
+    std::string json = trace::dump_json();
+    test_utils::test_assert(json.find("\"traceEvents\":[") !=
+                                std::string::npos,
+                            "The dump should be a trace-event document");
+    test_utils::test_assert(count(json, "\"name\":\"read\"") == 1 &&
+                                count(json, "\"name\":\"lookup\"") == 1,
+                            "Events from every thread should be dumped");
+    test_utils::test_assert(json.find("\"args\":{\"fd\":9}") !=
+                                std::string::npos,
+                            "Events should carry their descriptor");
+}
+
+// Test that each ring keeps only its newest events
+void test_ring_wraps() {
+    std::thread writer([]() {
+        for (int i = 0; i < 70000; ++i) {
+            trace::record(trace::SEND, i, 0, 1);
+        }
+    });
+    writer.join();
+    std::string json = trace::dump_json();
+    test_utils::test_assert(count(json, "\"name\":\"send\"") == 65536,
+                            "A full ring should hold its capacity");
+    test_utils::test_assert(json.find("\"fd\":69999}") != std::string::npos &&
+                                json.find("\"fd\":4463}") ==
+                                    std::string::npos,
+                            "The oldest events should be overwritten");
+}
+
+int main() {
+    std::cout << "===== Running Trace Tests =====" << std::endl;
+
+    test_utils::run_test("Trace Dump", test_dump);
+    test_utils::run_test("Ring Wraparound", test_ring_wraps);
+
+    test_utils::print_test_summary();
+
+    return 0;
+}